@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+#include "afinidad.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comun.h"
+
+static const char *nombres[] = { "ninguna", "compacta", "dispersa", "lista" };
+
+/*
+ * Interpreta una lista de CPUs al estilo de cpulist ("0-3,8,10-11").
+ * Retorna cuántas CPUs escribió en salida o -1 si el texto no es válido.
+ */
+static int leer_lista(const char *texto, int *salida, int max)
+{
+    int n = 0;
+    const char *p = texto;
+    while (*p && *p != '\n') {
+        char *fin;
+        long desde = strtol(p, &fin, 10), hasta = desde;
+        if (fin == p || desde < 0) return -1;
+        if (*fin == '-') {
+            p = fin + 1;
+            hasta = strtol(p, &fin, 10);
+            if (fin == p || hasta < desde) return -1;
+        }
+        for (long c = desde; c <= hasta; ++c) {
+            if (c >= MAX_CPUS || n >= max) return -1;
+            salida[n++] = (int)c;
+        }
+        p = fin;
+        if (*p == ',') p++;
+        else if (*p && *p != '\n') return -1;
+    }
+    return n;
+}
+
+/* Lee los nodos de /sys y se queda con las CPUs permitidas al proceso */
+static void leer_topologia(topologia *t)
+{
+    cpu_set_t permitidas;
+    if (sched_getaffinity(0, sizeof(permitidas), &permitidas) != 0) {
+        CPU_ZERO(&permitidas);
+        CPU_SET(0, &permitidas);
+    }
+    memset(t, 0, sizeof(*t));
+    for (int c = 0; c < MAX_CPUS; ++c) t->nodo_de[c] = -1;
+
+    int lista[MAX_CPUS];
+    for (int nodo = 0; nodo < MAX_NODOS; ++nodo) {
+        char ruta[64], linea[4096];
+        snprintf(ruta, sizeof(ruta), "/sys/devices/system/node/node%d/cpulist", nodo);
+        FILE *f = fopen(ruta, "r");
+        if (!f) continue;
+        int n = fgets(linea, sizeof(linea), f) ? leer_lista(linea, lista, MAX_CPUS) : -1;
+        fclose(f);
+
+        t->inicio_nodo[t->n_nodos] = t->n_cpus;
+        for (int k = 0; k < n; ++k) {
+            if (!CPU_ISSET(lista[k], &permitidas)) continue;
+            t->nodo_de[lista[k]] = t->n_nodos;
+            t->cpus[t->n_cpus++] = lista[k];
+        }
+        if (t->n_cpus > t->inicio_nodo[t->n_nodos])    // Nodos sin CPUs permitidas no cuentan
+            t->id_nodo[t->n_nodos++] = nodo;
+    }
+
+    if (t->n_cpus == 0) {
+        // Núcleo sin NUMA (o sin /sys): un solo nodo con todas las CPUs permitidas
+        t->n_nodos = 1;
+        for (int c = 0; c < MAX_CPUS && c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &permitidas)) { t->nodo_de[c] = 0; t->cpus[t->n_cpus++] = c; }
+    }
+    t->inicio_nodo[t->n_nodos] = t->n_cpus;
+}
+
+int afinidad_preparar(afinidad *a, const char *texto)
+{
+    memset(a, 0, sizeof(*a));
+    leer_topologia(&a->topo);
+    for (int m = AFINIDAD_NINGUNA; m < AFINIDAD_LISTA; ++m)
+        if (strcmp(texto, nombres[m]) == 0) { a->modo = m; return 0; }
+    a->modo = AFINIDAD_LISTA;
+    a->n_lista = leer_lista(texto, a->lista, MAX_CPUS);
+    for (int k = 0; k < a->n_lista; ++k)
+        if (a->topo.nodo_de[a->lista[k]] < 0) return -1;   // CPU inexistente o no permitida
+    return a->n_lista > 0 ? 0 : -1;
+}
+
+int afinidad_cpu(const afinidad *a, int trabajador)
+{
+    const topologia *t = &a->topo;
+    switch (a->modo) {
+    case AFINIDAD_COMPACTA:
+        return t->cpus[trabajador % t->n_cpus];
+    case AFINIDAD_DISPERSA: {
+        int k = trabajador % t->n_nodos;
+        int en_nodo = t->inicio_nodo[k + 1] - t->inicio_nodo[k];
+        return t->cpus[t->inicio_nodo[k] + (trabajador / t->n_nodos) % en_nodo];
+    }
+    case AFINIDAD_LISTA:
+        return a->lista[trabajador % a->n_lista];
+    default:
+        return -1;
+    }
+}
+
+int afinidad_fijar(const afinidad *a, int trabajador)
+{
+    int cpu = afinidad_cpu(a, trabajador);
+    if (cpu < 0) return -1;
+    cpu_set_t conjunto;
+    CPU_ZERO(&conjunto);
+    CPU_SET(cpu, &conjunto);
+    // Con pid 0 solo afecta al hilo que llama
+    if (sched_setaffinity(0, sizeof(conjunto), &conjunto) != 0) {
+        perror("sched_setaffinity");
+        return -1;
+    }
+    return cpu;
+}
+
+int afinidad_nodo(const afinidad *a, int cpu)
+{
+    return (cpu >= 0 && cpu < MAX_CPUS && a->topo.nodo_de[cpu] >= 0) ? a->topo.nodo_de[cpu] : 0;
+}
+
+const char *afinidad_nombre(const afinidad *a)
+{
+    return nombres[a->modo];
+}
+
+void afinidad_imprimir_nodos(const afinidad *a, const int *cpus, const long *cantidades,
+                             const double *tiempos, int n)
+{
+    printf("\n=== Ancho de banda por nodo NUMA (afinidad %s) ===\n", afinidad_nombre(a));
+    for (int k = 0; k < a->topo.n_nodos; ++k) {
+        int trabajadores = 0;
+        long notas = 0;
+        double lento = 0;
+        for (int i = 0; i < n; ++i) {
+            if (afinidad_nodo(a, cpus[i]) != k) continue;
+            trabajadores++;
+            notas += cantidades[i];
+            if (tiempos[i] > lento) lento = tiempos[i];
+        }
+        printf("Nodo %d: %d trabajador(es) | %ld notas | %.2f GB/s\n",
+               a->topo.id_nodo[k], trabajadores, notas, gbps(notas, lento));
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef AFINIDAD_H
+#define AFINIDAD_H
+
+#define MAX_CPUS  1024   // CPUs consideradas (como CPU_SETSIZE)
+#define MAX_NODOS 64     // Nodos NUMA considerados
+
+/* Política para fijar cada trabajador a una CPU */
+typedef enum {
+    AFINIDAD_NINGUNA,    // Los trabajadores flotan libremente (comportamiento original)
+    AFINIDAD_COMPACTA,   // Llena las CPUs de un nodo antes de pasar al siguiente
+    AFINIDAD_DISPERSA,   // Alterna los nodos: trabajador i en el nodo i % nodos
+    AFINIDAD_LISTA       // CPUs dadas explícitamente, p. ej. "0,2,4-7"
+} modo_afinidad;
+
+/*
+ * Topología leída de /sys/devices/system/node, limitada a las CPUs que el
+ * proceso tiene permitidas. Sin NUMA en el núcleo se ve como un solo nodo.
+ */
+typedef struct {
+    int n_nodos;
+    int id_nodo[MAX_NODOS];          // Número del nodo en el sistema
+    int inicio_nodo[MAX_NODOS + 1];  // cpus[inicio_nodo[k] .. inicio_nodo[k+1]) son del nodo k
+    int n_cpus;
+    int cpus[MAX_CPUS];              // CPUs permitidas ordenadas por nodo
+    int nodo_de[MAX_CPUS];           // Índice de nodo de cada CPU (por número de CPU)
+} topologia;
+
+typedef struct {
+    modo_afinidad modo;
+    int n_lista;
+    int lista[MAX_CPUS];             // CPUs de AFINIDAD_LISTA, en el orden dado
+    topologia topo;
+} afinidad;
+
+/*
+ * Lee la topología e interpreta texto: "ninguna", "compacta", "dispersa" o una
+ * lista de CPUs ("0,2,4-7"). Retorna 0 o -1 si el texto no es válido o nombra
+ * una CPU que el proceso no puede usar.
+ */
+int afinidad_preparar(afinidad *a, const char *texto);
+
+/* CPU asignada al trabajador i, o -1 si no se fija */
+int afinidad_cpu(const afinidad *a, int trabajador);
+
+/*
+ * Fija el hilo que llama a la CPU del trabajador i (antes de tocar sus datos,
+ * para que sus páginas se asignen en su nodo). Retorna la CPU o -1.
+ */
+int afinidad_fijar(const afinidad *a, int trabajador);
+
+/* Índice de nodo (0..n_nodos-1) de una CPU, o 0 si no se conoce */
+int afinidad_nodo(const afinidad *a, int cpu);
+
+/* Nombre de la política para los reportes */
+const char *afinidad_nombre(const afinidad *a);
+
+/*
+ * Imprime el ancho de banda por nodo: por cada nodo suma las notas de los
+ * trabajadores que terminaron en él y divide por el tiempo del más lento.
+ * cpus, cantidades, tiempos: CPU final, notas procesadas y tiempo de cada trabajador.
+ */
+void afinidad_imprimir_nodos(const afinidad *a, const int *cpus, const long *cantidades,
+                             const double *tiempos, int n);
+
+#endif
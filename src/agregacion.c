@@ -0,0 +1,111 @@
+#include "agregacion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "comun.h"
+
+static const char *nombres[] = { "mutex", "atomico", "ranuras" };
+
+size_t agregador_tamano(int n)
+{
+    return sizeof(agregador) + sizeof(ranura) * (size_t)n;
+}
+
+void agregador_iniciar(agregador *a, modo_agregacion modo, int n, int compartido)
+{
+    memset(a, 0, agregador_tamano(n));
+    a->modo = modo;
+    a->n = n;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (compartido)
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&a->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    for (int k = 0; k < 3; ++k)
+        atomic_init(&a->atomicos[k], 0);
+}
+
+agregador *agregador_nuevo(modo_agregacion modo, int n)
+{
+    size_t bytes = (agregador_tamano(n) + LINEA_CACHE - 1) & ~(size_t)(LINEA_CACHE - 1);
+    agregador *a = aligned_alloc(LINEA_CACHE, bytes);
+    if (a) agregador_iniciar(a, modo, n, 0);
+    return a;
+}
+
+void agregador_sumar(agregador *a, int id, const conteo *c)
+{
+    long long v[3] = { c->reprobados, c->aprobado_bajo, c->aprobado_alto };
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    switch (a->modo) {
+    case AGREGA_MUTEX:
+        // Sección crítica: actualiza los totales globales
+        pthread_mutex_lock(&a->mutex);
+        for (int k = 0; k < 3; ++k) a->protegidos[k] += v[k];
+        pthread_mutex_unlock(&a->mutex);
+        break;
+    case AGREGA_ATOMICO:
+        for (int k = 0; k < 3; ++k)
+            atomic_fetch_add_explicit(&a->atomicos[k], v[k], memory_order_relaxed);
+        break;
+    case AGREGA_RANURAS:
+        // Solo este trabajador escribe su ranura; la lectura ocurre tras join/wait
+        for (int k = 0; k < 3; ++k) a->ranuras[id].totales[k] += v[k];
+        break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    a->ranuras[id].espera += segundos_entre(t0, t1);
+}
+
+void agregador_totales(const agregador *a, long long totales[3])
+{
+    for (int k = 0; k < 3; ++k) {
+        switch (a->modo) {
+        case AGREGA_MUTEX:   totales[k] = a->protegidos[k]; break;
+        case AGREGA_ATOMICO: totales[k] = atomic_load((_Atomic long long *)&a->atomicos[k]); break;
+        case AGREGA_RANURAS:
+            totales[k] = 0;
+            for (int i = 0; i < a->n; ++i) totales[k] += a->ranuras[i].totales[k];
+            break;
+        }
+    }
+}
+
+void agregador_destruir(agregador *a)
+{
+    pthread_mutex_destroy(&a->mutex);
+}
+
+const char *agregacion_nombre(modo_agregacion modo)
+{
+    return nombres[modo];
+}
+
+int agregacion_desde_texto(const char *texto)
+{
+    for (int i = 0; i < 3; ++i)
+        if (strcmp(texto, nombres[i]) == 0) return i;
+    return -1;
+}
+
+double agregador_espera_maxima(const agregador *a)
+{
+    double maxima = 0;
+    for (int i = 0; i < a->n; ++i)
+        if (a->ranuras[i].espera > maxima) maxima = a->ranuras[i].espera;
+    return maxima;
+}
+
+void agregador_imprimir_esperas(const agregador *a)
+{
+    double total = 0, maxima = agregador_espera_maxima(a);
+    for (int i = 0; i < a->n; ++i)
+        total += a->ranuras[i].espera;
+    printf("Espera en la agregación (%s): promedio %.3f us | máxima %.3f us | suma %.3f us\n",
+           agregacion_nombre(a->modo), 1e6 * total / a->n, 1e6 * maxima, 1e6 * total);
+}
@@ -0,0 +1,69 @@
+#ifndef AGREGACION_H
+#define AGREGACION_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "clasificacion.h"
+
+#define LINEA_CACHE 64   // Tamaño de línea de caché usado para separar datos por trabajador
+
+/* Forma de acumular los totales globales */
+typedef enum {
+    AGREGA_MUTEX,     // Un mutex protege los tres totales (comportamiento original)
+    AGREGA_ATOMICO,   // atomic_fetch_add sobre cada total, sin bloqueo
+    AGREGA_RANURAS    // Cada trabajador escribe su ranura y se reduce al final
+} modo_agregacion;
+
+/* Ranura de un trabajador: ocupa su propia línea de caché para evitar falso compartir */
+typedef struct {
+    _Alignas(LINEA_CACHE) long long totales[3]; // [reprobados, aprobado_bajo, aprobado_alto]
+    double espera;        // Segundos dentro de agregador_sumar (esperando el mutex o en atómicos)
+} ranura;
+
+/*
+ * Agregador de totales globales. No contiene punteros, así que puede vivir en
+ * memoria compartida entre procesos igual que en la memoria de un proceso con hilos.
+ */
+typedef struct {
+    modo_agregacion modo;
+    int n;                                        // Cantidad de ranuras
+    pthread_mutex_t mutex;                        // Usado solo en AGREGA_MUTEX
+    _Alignas(LINEA_CACHE) long long protegidos[3]; // Totales bajo mutex
+    _Alignas(LINEA_CACHE) _Atomic long long atomicos[3]; // Totales con fetch-add
+    ranura ranuras[];                             // Una por trabajador
+} agregador;
+
+/* Bytes necesarios para un agregador de n trabajadores */
+size_t agregador_tamano(int n);
+
+/*
+ * Inicializa a para n trabajadores. compartido: 1 si lo usarán varios procesos
+ * (el mutex se crea con PTHREAD_PROCESS_SHARED).
+ */
+void agregador_iniciar(agregador *a, modo_agregacion modo, int n, int compartido);
+
+/* Reserva (alineado a línea de caché) e inicializa un agregador para los hilos de un proceso */
+agregador *agregador_nuevo(modo_agregacion modo, int n);
+
+/* Suma el conteo del trabajador id a los totales y mide cuánto tardó en hacerlo */
+void agregador_sumar(agregador *a, int id, const conteo *c);
+
+/* Totales globales finales: con ranuras hace la reducción sobre todas ellas */
+void agregador_totales(const agregador *a, long long totales[3]);
+
+/* Destruye el mutex; los creados con agregador_nuevo se liberan además con free() */
+void agregador_destruir(agregador *a);
+
+/* Nombre del modo y conversión desde texto ("mutex", "atomico", "ranuras"); -1 si no existe */
+const char *agregacion_nombre(modo_agregacion modo);
+int agregacion_desde_texto(const char *texto);
+
+/* Mayor espera de un trabajador en el camino de agregación, en segundos */
+double agregador_espera_maxima(const agregador *a);
+
+/* Imprime la espera de cada trabajador en el camino de agregación */
+void agregador_imprimir_esperas(const agregador *a);
+
+#endif
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE   /* open_memstream */
+#include "agrupacion.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CAPACIDAD_INICIAL 1024   // Filas con que empieza cada tabla local
+#define TABLAS_EN_CACHE (1UL << 20) // Más allá de esto (~L2) las tablas locales se leen con prebúsqueda
+#define DISTANCIA 16             // Notas de adelanto de la prebúsqueda
+
+/*
+ * Finalizador de murmur3 (32 bits): toda la clave influye en todos los bits,
+ * así claves consecutivas o múltiplos de una potencia de dos no se amontonan.
+ */
+static inline uint32_t dispersar(clave_t k)
+{
+    k ^= k >> 16;
+    k *= 0x85EBCA6BU;
+    k ^= k >> 13;
+    k *= 0xC2B2AE35U;
+    k ^= k >> 16;
+    return k;
+}
+
+/*
+ * Partición de una clave por rango: [0, secciones) se corta en p->n tramos
+ * iguales (escala = n * 2^32 / secciones) y las claves mayores van al último.
+ * Es monótona en la clave, así que las particiones ordenadas una tras otra
+ * quedan ordenadas en conjunto.
+ */
+static inline int particion_de(const particiones_grupos *p, clave_t k)
+{
+    int q = (int)(((uint64_t)k * p->escala) >> 32);
+    return q < p->n ? q : p->n - 1;
+}
+
+/* Categoría de una nota con los mismos límites que clasificar() */
+static inline int categoria(int nota)
+{
+    return (nota >= 18) + (nota >= 28);
+}
+
+/* Reserva una tabla vacía de capacidad filas (potencia de dos); 0 o -1 */
+static int tabla_nueva(tabla_grupos *t, long capacidad)
+{
+    t->filas = malloc(sizeof(fila_grupo) * capacidad);
+    if (!t->filas) return -1;
+    for (long i = 0; i < capacidad; ++i) t->filas[i].clave = CLAVE_VACIA;
+    t->capacidad = capacidad;
+    t->usadas = 0;
+    return 0;
+}
+
+/* Fila de la clave k (con dispersión h) en t, creándola en cero si no estaba */
+static inline fila_grupo *tabla_buscar(tabla_grupos *t, clave_t k, uint32_t h)
+{
+    long mascara = t->capacidad - 1;
+    long i = h & mascara;   // La dispersión reparte las claves de un mismo tramo por toda la tabla
+    while (t->filas[i].clave != k) {
+        if (t->filas[i].clave == CLAVE_VACIA) {
+            t->filas[i] = (fila_grupo){ .clave = k };
+            t->usadas++;
+            break;
+        }
+        i = (i + 1) & mascara;
+    }
+    return &t->filas[i];
+}
+
+/* Duplica la capacidad de t y reubica sus filas; 0 o -1 */
+static int tabla_crecer(tabla_grupos *t, long capacidad)
+{
+    tabla_grupos nueva;
+    if (tabla_nueva(&nueva, capacidad) != 0) return -1;
+    for (long i = 0; i < t->capacidad; ++i) {
+        const fila_grupo *f = &t->filas[i];
+        if (f->clave != CLAVE_VACIA) *tabla_buscar(&nueva, f->clave, dispersar(f->clave)) = *f;
+    }
+    free(t->filas);
+    *t = nueva;
+    return 0;
+}
+
+/* Fila de la clave k, haciendo crecer la tabla para mantener la carga bajo 1/2 */
+static inline fila_grupo *tabla_fila(tabla_grupos *t, clave_t k, uint32_t h)
+{
+    if (2 * (t->usadas + 1) > t->capacidad && tabla_crecer(t, 2 * t->capacidad) != 0) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    return tabla_buscar(t, k, h);
+}
+
+int particiones_iniciar(particiones_grupos *p, int n, uint32_t secciones)
+{
+    p->n = n;
+    p->escala = ((uint64_t)n << 32) / (secciones ? secciones : (uint64_t)1 << 32);
+    p->descartadas = 0;
+    p->fuera = 0;
+    p->tablas = calloc((size_t)n, sizeof(tabla_grupos));
+    if (!p->tablas) return -1;
+    for (int k = 0; k < n; ++k)
+        if (tabla_nueva(&p->tablas[k], CAPACIDAD_INICIAL) != 0) return -1;
+    return 0;
+}
+
+void particiones_liberar(particiones_grupos *p)
+{
+    for (int k = 0; p->tablas && k < p->n; ++k) tabla_liberar(&p->tablas[k]);
+    free(p->tablas);
+    p->tablas = NULL;
+}
+
+/* Acumula una nota en la fila de su clave */
+static inline void agrupar_nota(particiones_grupos *p, nota_t nota, clave_t k)
+{
+    if (k == CLAVE_VACIA) { p->descartadas++; return; }
+    p->fuera += (unsigned)nota > MAX_NOTA;
+    uint32_t h = dispersar(k);
+    fila_grupo *f = tabla_fila(&p->tablas[particion_de(p, k)], k, h);
+    f->suma += nota;
+    f->cuenta[categoria(nota)]++;
+}
+
+void agrupar(const nota_t *notas, const clave_t *claves, long cantidad, particiones_grupos *p)
+{
+    size_t bytes = 0;
+    for (int k = 0; k < p->n; ++k) bytes += sizeof(fila_grupo) * (size_t)p->tablas[k].capacidad;
+    long i = 0;
+    if (bytes > TABLAS_EN_CACHE) {
+        // Con muchas claves cada búsqueda es un fallo de caché: se pide la fila
+        // de la nota que viene DISTANCIA posiciones más adelante mientras se suma esta
+        for (; i + DISTANCIA < cantidad; ++i) {
+            clave_t k = claves[i + DISTANCIA];
+            uint32_t h = dispersar(k);
+            const tabla_grupos *t = &p->tablas[particion_de(p, k)];
+            __builtin_prefetch(&t->filas[h & (t->capacidad - 1)], 1);
+            agrupar_nota(p, notas[i], claves[i]);
+        }
+    }
+    for (; i < cantidad; ++i)
+        agrupar_nota(p, notas[i], claves[i]);
+}
+
+void particiones_conteo(const particiones_grupos *p, conteo *c)
+{
+    for (int k = 0; k < p->n; ++k) {
+        const tabla_grupos *t = &p->tablas[k];
+        for (long i = 0; i < t->capacidad; ++i) {
+            if (t->filas[i].clave == CLAVE_VACIA) continue;
+            c->suma          += t->filas[i].suma;
+            c->reprobados    += t->filas[i].cuenta[0];
+            c->aprobado_bajo += t->filas[i].cuenta[1];
+            c->aprobado_alto += t->filas[i].cuenta[2];
+        }
+    }
+    c->fuera += p->fuera;
+}
+
+int tabla_reservar(tabla_grupos *t, long n)
+{
+    long capacidad = CAPACIDAD_INICIAL;
+    while (capacidad < 2 * n) capacidad *= 2;
+    if (!t->filas) return tabla_nueva(t, capacidad);
+    return capacidad > t->capacidad ? tabla_crecer(t, capacidad) : 0;
+}
+
+void tabla_mezclar(tabla_grupos *t, const fila_grupo *filas, long n)
+{
+    for (long i = 0; i < n; ++i) {
+        const fila_grupo *o = &filas[i];
+        if (o->clave == CLAVE_VACIA) continue;
+        fila_grupo *f = tabla_fila(t, o->clave, dispersar(o->clave));
+        f->suma += o->suma;
+        for (int c = 0; c < 3; ++c) f->cuenta[c] += o->cuenta[c];
+    }
+}
+
+static int comparar_claves(const void *a, const void *b)
+{
+    clave_t x = ((const fila_grupo *)a)->clave, y = ((const fila_grupo *)b)->clave;
+    return (x > y) - (x < y);
+}
+
+long tabla_ordenar(tabla_grupos *t)
+{
+    long n = 0;
+    for (long i = 0; i < t->capacidad; ++i)
+        if (t->filas[i].clave != CLAVE_VACIA) t->filas[n++] = t->filas[i];
+    qsort(t->filas, (size_t)n, sizeof(fila_grupo), comparar_claves);
+    return n;
+}
+
+void tabla_liberar(tabla_grupos *t)
+{
+    free(t->filas);
+    t->filas = NULL;
+    t->capacidad = t->usadas = 0;
+}
+
+size_t particiones_bytes(const particiones_grupos *p)
+{
+    size_t bytes = sizeof(long) * (size_t)(p->n + 2);
+    for (int k = 0; k < p->n; ++k) bytes += sizeof(fila_grupo) * (size_t)p->tablas[k].usadas;
+    return bytes;
+}
+
+void particiones_volcar(const particiones_grupos *p, void *destino)
+{
+    long *cabecera = destino;   // n y n + 1 desplazamientos
+    long *desde = cabecera + 1;
+    fila_grupo *filas = (fila_grupo *)(desde + p->n + 1);
+    long n = 0;
+    cabecera[0] = p->n;
+    for (int k = 0; k < p->n; ++k) {
+        desde[k] = n;
+        const tabla_grupos *t = &p->tablas[k];
+        for (long i = 0; i < t->capacidad; ++i)
+            if (t->filas[i].clave != CLAVE_VACIA) filas[n++] = t->filas[i];
+    }
+    desde[p->n] = n;
+}
+
+const fila_grupo *particion_volcada(const void *bloque, int k, long *n)
+{
+    const long *cabecera = bloque;
+    const long *desde = cabecera + 1;
+    const fila_grupo *filas = (const fila_grupo *)(desde + cabecera[0] + 1);
+    *n = desde[k + 1] - desde[k];
+    return filas + desde[k];
+}
+
+static inline long long notas_de(const fila_grupo *f)
+{
+    return f->cuenta[0] + f->cuenta[1] + f->cuenta[2];
+}
+
+void grupos_resumir(const fila_grupo *filas, long n, resumen_grupos *r)
+{
+    *r = (resumen_grupos){ .claves = n };
+    for (long i = 0; i < n; ++i) {
+        long long cuantas = notas_de(&filas[i]);
+        double promedio = (double)filas[i].suma / cuantas;
+        r->notas += cuantas;
+        // Las filas vienen ordenadas por clave: ante un empate queda la menor
+        if (i == 0 || promedio > r->promedio_mejor) { r->mejor = filas[i].clave; r->promedio_mejor = promedio; }
+        if (i == 0 || promedio < r->promedio_peor)  { r->peor  = filas[i].clave; r->promedio_peor  = promedio; }
+    }
+}
+
+void grupos_combinar(resumen_grupos *destino, const resumen_grupos *origen)
+{
+    if (origen->claves > 0) {
+        int vacio = destino->claves == 0;
+        if (vacio || origen->promedio_mejor > destino->promedio_mejor ||
+            (origen->promedio_mejor == destino->promedio_mejor && origen->mejor < destino->mejor)) {
+            destino->mejor = origen->mejor;
+            destino->promedio_mejor = origen->promedio_mejor;
+        }
+        if (vacio || origen->promedio_peor < destino->promedio_peor ||
+            (origen->promedio_peor == destino->promedio_peor && origen->peor < destino->peor)) {
+            destino->peor = origen->peor;
+            destino->promedio_peor = origen->promedio_peor;
+        }
+    }
+    destino->claves        += origen->claves;
+    destino->notas         += origen->notas;
+    destino->filas_locales += origen->filas_locales;
+    destino->descartadas   += origen->descartadas;
+    if (origen->local > destino->local) destino->local = origen->local;
+    if (origen->mezcla > destino->mezcla) destino->mezcla = origen->mezcla;
+}
+
+char *grupos_csv(const fila_grupo *filas, long n, size_t *bytes)
+{
+    char *texto = NULL;
+    FILE *s = open_memstream(&texto, bytes);
+    if (!s) return NULL;
+    for (long i = 0; i < n; ++i) {
+        const fila_grupo *f = &filas[i];
+        long long cuantas = notas_de(f);
+        fprintf(s, "%u,%lld,%.4f,%lld,%lld,%lld\n", f->clave, cuantas, (double)f->suma / cuantas,
+                f->cuenta[0], f->cuenta[1], f->cuenta[2]);
+    }
+    if (fclose(s) != 0) { free(texto); return NULL; }
+    return texto;
+}
+
+int grupos_abrir_salida(const char *ruta)
+{
+    int fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || grupos_escribir(fd, GRUPOS_CABECERA_CSV, strlen(GRUPOS_CABECERA_CSV), 0) != 0) {
+        perror(ruta);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int grupos_escribir(int fd, const char *texto, size_t bytes, off_t desde)
+{
+    size_t escritos = 0;
+    while (escritos < bytes) {
+        ssize_t n = pwrite(fd, texto + escritos, bytes - escritos, desde + (off_t)escritos);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        escritos += (size_t)n;
+    }
+    return 0;
+}
+
+void grupos_imprimir(const resumen_grupos *r, int n_particiones, const char *salida)
+{
+    printf("\n=== Agrupación por clave (%d particiones) ===\n", n_particiones);
+    printf("Claves distintas: %ld | Notas agrupadas: %lld | Notas por clave: %.1f\n",
+           r->claves, r->notas, r->claves ? (double)r->notas / r->claves : 0.0);
+    if (r->claves > 0)
+        printf("Mayor promedio: clave %u (%.4f) | Menor promedio: clave %u (%.4f)\n",
+               r->mejor, r->promedio_mejor, r->peor, r->promedio_peor);
+    printf("Agregación local: %.6f s | Mezcla por particiones: %.6f s (%ld filas locales, %.2f por clave)\n",
+           r->local, r->mezcla, r->filas_locales, r->claves ? (double)r->filas_locales / r->claves : 0.0);
+    if (r->descartadas)
+        printf("Notas descartadas (clave reservada %u): %lld\n", CLAVE_VACIA, r->descartadas);
+    if (salida) printf("Salida: %s (%ld filas)\n", salida, r->claves);
+}
@@ -0,0 +1,120 @@
+#ifndef AGRUPACION_H
+#define AGRUPACION_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "clasificacion.h"
+
+#define SECCIONES_DEFECTO 1000   // Claves distintas generadas si no se indica --secciones
+
+/*
+ * Acumulado de una clave: suma de sus notas y sus tres categorías
+ * (la cantidad de notas es la suma de las categorías).
+ */
+typedef struct {
+    clave_t clave;            // CLAVE_VACIA en los lugares libres de la tabla
+    long long suma;
+    long long cuenta[3];      // Reprobados (<18), aprobados bajos (18-27) y altos (>=28)
+} fila_grupo;
+
+/* Tabla hash de direccionamiento abierto (sondeo lineal) de clave a fila_grupo */
+typedef struct {
+    fila_grupo *filas;
+    long capacidad;           // Potencia de dos
+    long usadas;
+} tabla_grupos;
+
+/*
+ * Tablas locales de un trabajador, una por partición. Cada partición es un
+ * tramo contiguo de claves, así que cada trabajador puede mezclar después una
+ * partición entera de todos los demás sin bloqueos, y las particiones escritas
+ * en orden dejan todo el CSV ordenado por clave sin otra fusión.
+ */
+typedef struct {
+    int n;                    // Particiones (una por trabajador)
+    uint64_t escala;          // n * 2^32 / secciones: la partición de k es (k * escala) >> 32
+    tabla_grupos *tablas;
+    long long descartadas;    // Notas con la clave reservada CLAVE_VACIA
+    long long fuera;          // Notas fuera de [0, MAX_NOTA] (la corrida se rechaza)
+} particiones_grupos;
+
+/* Resumen de las claves de una o varias particiones ya mezcladas */
+typedef struct {
+    long claves;              // Claves distintas
+    long long notas;          // Notas agrupadas
+    long filas_locales;       // Filas de las tablas locales que entraron en la mezcla
+    long long descartadas;    // Notas con la clave reservada CLAVE_VACIA
+    clave_t mejor, peor;      // Claves con el mayor y el menor promedio (la menor clave si empatan)
+    double promedio_mejor, promedio_peor;
+    double local;             // Segundos de la agregación local (el máximo al combinar)
+    double mezcla;            // Segundos de la mezcla, el orden y la escritura (el máximo al combinar)
+} resumen_grupos;
+
+/* Cabecera del CSV de --salida-grupos */
+#define GRUPOS_CABECERA_CSV "clave,notas,promedio,reprobados,aprobado_bajo,aprobado_alto\n"
+
+/*
+ * Prepara n particiones vacías para claves en [0, secciones), repartidas en
+ * tramos iguales (0 si no se conoce el rango: se reparte todo clave_t y con
+ * claves chicas casi todas caen en la primera). Retorna 0 o -1 si falta memoria.
+ */
+int particiones_iniciar(particiones_grupos *p, int n, uint32_t secciones);
+void particiones_liberar(particiones_grupos *p);
+
+/* Acumula cada notas[i] en la fila de claves[i], en la tabla de su partición */
+void agrupar(const nota_t *notas, const clave_t *claves, long cantidad, particiones_grupos *p);
+
+/* Suma a c la suma de notas, las tres categorías y las notas fuera de rango de todas las particiones */
+void particiones_conteo(const particiones_grupos *p, conteo *c);
+
+/* Reserva espacio en t para al menos n claves sin tener que crecer; 0 o -1 */
+int tabla_reservar(tabla_grupos *t, long n);
+
+/* Suma a t las filas ocupadas de filas[0 .. n) (se saltan las libres) */
+void tabla_mezclar(tabla_grupos *t, const fila_grupo *filas, long n);
+
+/*
+ * Deja las filas ocupadas al comienzo de t->filas, ordenadas por clave, y
+ * retorna cuántas son. Después la tabla ya no sirve para buscar.
+ */
+long tabla_ordenar(tabla_grupos *t);
+void tabla_liberar(tabla_grupos *t);
+
+/*
+ * Copia las particiones a destino como un bloque sin punteros (para que otros
+ * procesos lo lean desde memoria compartida): n, n + 1 desplazamientos y las
+ * filas ocupadas de cada partición, una tras otra. particiones_bytes da el tamaño.
+ */
+size_t particiones_bytes(const particiones_grupos *p);
+void particiones_volcar(const particiones_grupos *p, void *destino);
+
+/* Filas de la partición k dentro de un bloque de particiones_volcar() */
+const fila_grupo *particion_volcada(const void *bloque, int k, long *n);
+
+/* Resumen de filas[0 .. n) (ordenadas por tabla_ordenar) */
+void grupos_resumir(const fila_grupo *filas, long n, resumen_grupos *r);
+
+/* Suma el resumen de una partición al de todas */
+void grupos_combinar(resumen_grupos *destino, const resumen_grupos *origen);
+
+/*
+ * Da formato CSV (sin cabecera) a filas[0 .. n) en un búfer nuevo que
+ * luego se libera con free(); *bytes recibe su largo. NULL si falta memoria.
+ */
+char *grupos_csv(const fila_grupo *filas, long n, size_t *bytes);
+
+/*
+ * Crea (o vacía) el archivo de --salida-grupos y escribe la cabecera; las filas
+ * las escribe después cada trabajador en su lugar con grupos_escribir().
+ * Retorna el descriptor o -1 (con el motivo en stderr).
+ */
+int grupos_abrir_salida(const char *ruta);
+
+/* Escribe texto[0 .. bytes) en fd desde la posición desde, sin mover su cursor; 0 o -1 (con errno) */
+int grupos_escribir(int fd, const char *texto, size_t bytes, off_t desde);
+
+/* Imprime el resumen de la agrupación de n_particiones particiones */
+void grupos_imprimir(const resumen_grupos *r, int n_particiones, const char *salida);
+
+#endif
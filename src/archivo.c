@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include "archivo.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "generador.h"
+
+#define NOTAS_POR_ESCRITURA (1L << 20)   // Notas generadas por cada escritura al exportar
+
+_Static_assert(sizeof(cabecera_notas) == 64, "la cabecera debe medir 64 bytes");
+
+/* Posición de la primera clave: después de las notas, en el siguiente múltiplo de 64 bytes */
+static size_t desplazamiento_claves(long cantidad)
+{
+    size_t fin = sizeof(cabecera_notas) + (size_t)cantidad * sizeof(nota_t);
+    return (fin + 63) & ~(size_t)63;
+}
+
+int archivo_abrir(archivo_notas *a, const char *ruta, int completo)
+{
+    memset(a, 0, sizeof(*a));
+    a->fd = open(ruta, O_RDONLY);
+    if (a->fd < 0) { perror(ruta); return -1; }
+
+    cabecera_notas cab;
+    struct stat st;
+    if (pread(a->fd, &cab, sizeof(cab), 0) != (ssize_t)sizeof(cab) || fstat(a->fd, &st) != 0) {
+        fprintf(stderr, "%s: no se pudo leer la cabecera\n", ruta);
+        goto error;
+    }
+    if (memcmp(cab.magia, ARCHIVO_MAGIA, sizeof(cab.magia)) != 0 || cab.version != ARCHIVO_VERSION) {
+        fprintf(stderr, "%s: no es un archivo de notas (versión %d)\n", ruta, ARCHIVO_VERSION);
+        goto error;
+    }
+    if (cab.bytes_por_nota != sizeof(nota_t)) {
+        fprintf(stderr, "%s: notas de %u byte(s), este programa usa %zu\n",
+                ruta, cab.bytes_por_nota, sizeof(nota_t));
+        goto error;
+    }
+    // Se acota la cantidad antes de multiplicarla: una cabecera manipulada no desborda el tamaño
+    if (cab.cantidad > ((uint64_t)st.st_size - sizeof(cab)) / sizeof(nota_t)) {
+        fprintf(stderr, "%s: truncado (%llu notas en la cabecera)\n", ruta, (unsigned long long)cab.cantidad);
+        goto error;
+    }
+    a->con_claves = (cab.banderas & ARCHIVO_CLAVES) != 0;
+    size_t bytes = a->con_claves ? desplazamiento_claves((long)cab.cantidad) + cab.cantidad * sizeof(clave_t)
+                                 : sizeof(cab) + cab.cantidad * sizeof(nota_t);
+    if ((uint64_t)st.st_size < bytes) {
+        fprintf(stderr, "%s: truncado (%llu notas en la cabecera)\n", ruta, (unsigned long long)cab.cantidad);
+        goto error;
+    }
+    a->cantidad = (long)cab.cantidad;
+    a->semilla  = cab.semilla;
+    a->secciones = a->con_claves ? cab.secciones : 0;
+
+    if (completo) {
+        // Todo el archivo de una vez: se prefallan las páginas y se pide lectura anticipada
+        a->bytes_mapeo = bytes;
+        a->mapeo = mmap(NULL, a->bytes_mapeo, PROT_READ, MAP_SHARED | MAP_POPULATE, a->fd, 0);
+        if (a->mapeo == MAP_FAILED) { a->mapeo = NULL; perror("mmap"); goto error; }
+        madvise(a->mapeo, a->bytes_mapeo, MADV_SEQUENTIAL);
+        a->notas = (nota_t *)((char *)a->mapeo + sizeof(cab));
+        if (a->con_claves) a->claves = (clave_t *)((char *)a->mapeo + desplazamiento_claves(a->cantidad));
+    }
+    return 0;
+
+error:
+    close(a->fd);
+    a->fd = -1;
+    return -1;
+}
+
+int archivo_fuera_de_rango(const char *ruta, long long fuera)
+{
+    if (fuera == 0) return 0;
+    fprintf(stderr, "%s: %lld nota(s) fuera de [0, %d]\n", ruta, fuera, MAX_NOTA);
+    return -1;
+}
+
+const nota_t *archivo_ventana(const archivo_notas *a, long inicio, long cantidad, ventana *v)
+{
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t desde = sizeof(cabecera_notas) + (size_t)inicio * sizeof(nota_t);
+    size_t alineado = desde & ~(pagina - 1);   // mmap exige un desplazamiento múltiplo de página
+    v->bytes = desde - alineado + (size_t)cantidad * sizeof(nota_t);
+    v->base = mmap(NULL, v->bytes, PROT_READ, MAP_SHARED | MAP_POPULATE, a->fd, (off_t)alineado);
+    if (v->base == MAP_FAILED) { v->base = NULL; return NULL; }
+    return (const nota_t *)((char *)v->base + (desde - alineado));
+}
+
+void ventana_liberar(ventana *v)
+{
+    if (v->base) munmap(v->base, v->bytes);
+    v->base = NULL;
+}
+
+void archivo_cerrar(archivo_notas *a)
+{
+    if (a->mapeo) munmap(a->mapeo, a->bytes_mapeo);
+    if (a->fd >= 0) close(a->fd);
+    a->mapeo = NULL;
+    a->fd = -1;
+}
+
+int archivo_exportar(const char *ruta, long cantidad, uint64_t semilla, uint32_t secciones)
+{
+    FILE *f = fopen(ruta, "wb");
+    if (!f) return -1;
+    cabecera_notas cab = { .version = ARCHIVO_VERSION, .bytes_por_nota = sizeof(nota_t),
+                           .cantidad = (uint64_t)cantidad, .semilla = semilla,
+                           .banderas = secciones ? ARCHIVO_CLAVES : 0, .secciones = secciones };
+    memcpy(cab.magia, ARCHIVO_MAGIA, sizeof(cab.magia));
+    // El búfer alcanza para un tramo de notas o de claves
+    void *bufer = malloc(sizeof(clave_t) * NOTAS_POR_ESCRITURA);
+    int ok = bufer && fwrite(&cab, sizeof(cab), 1, f) == 1;
+    for (long i = 0; ok && i < cantidad; i += NOTAS_POR_ESCRITURA) {
+        long n = cantidad - i < NOTAS_POR_ESCRITURA ? cantidad - i : NOTAS_POR_ESCRITURA;
+        generar_notas_en(bufer, i, n, semilla);
+        ok = fwrite(bufer, sizeof(nota_t), (size_t)n, f) == (size_t)n;
+    }
+    if (ok && secciones) {
+        // Relleno hasta el comienzo de las claves
+        static const char ceros[64];
+        size_t relleno = desplazamiento_claves(cantidad) - sizeof(cab) - (size_t)cantidad * sizeof(nota_t);
+        ok = fwrite(ceros, 1, relleno, f) == relleno;
+    }
+    for (long i = 0; ok && secciones && i < cantidad; i += NOTAS_POR_ESCRITURA) {
+        long n = cantidad - i < NOTAS_POR_ESCRITURA ? cantidad - i : NOTAS_POR_ESCRITURA;
+        generar_claves_en(bufer, i, n, semilla, secciones);
+        ok = fwrite(bufer, sizeof(clave_t), (size_t)n, f) == (size_t)n;
+    }
+    free(bufer);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok && errno == 0) errno = EIO;
+    return ok ? 0 : -1;
+}
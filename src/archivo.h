@@ -0,0 +1,88 @@
+#ifndef ARCHIVO_H
+#define ARCHIVO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "comun.h"
+
+#define ARCHIVO_MAGIA   "NOTASBIN"   // Primeros 8 bytes de todo archivo de notas
+#define ARCHIVO_VERSION 1
+#define ARCHIVO_CLAVES  1ULL         // Bandera: tras las notas (alineadas a 64 bytes) hay una clave por nota
+
+/*
+ * Cabecera de 64 bytes de un archivo de notas. Le siguen `cantidad` notas de
+ * `bytes_por_nota` bytes cada una, sin separadores y, con ARCHIVO_CLAVES, desde
+ * el siguiente múltiplo de 64 bytes, `cantidad` claves de 4 bytes (clave_t).
+ * Los enteros se guardan en el orden de bytes de la máquina que escribió el
+ * archivo (little endian en x86).
+ */
+typedef struct {
+    char magia[8];            // ARCHIVO_MAGIA
+    uint32_t version;         // ARCHIVO_VERSION
+    uint32_t bytes_por_nota;  // sizeof(nota_t) de quien lo escribió (1 o 4)
+    uint64_t cantidad;        // Notas en el archivo
+    uint64_t semilla;         // Semilla con que se generó (0 si son notas reales)
+    uint64_t banderas;        // ARCHIVO_CLAVES o 0
+    uint32_t secciones;       // Con ARCHIVO_CLAVES, las claves están en [0, secciones) (0 si no se sabe)
+    uint8_t reservado[20];    // Relleno hasta 64 bytes (las notas quedan alineadas)
+} cabecera_notas;
+
+/* Archivo de notas abierto; las notas empiezan en sizeof(cabecera_notas) */
+typedef struct {
+    int fd;
+    long cantidad;            // Notas en el archivo
+    uint64_t semilla;         // Semilla registrada en la cabecera
+    void *mapeo;              // Mapeo completo (NULL en modo ventana)
+    size_t bytes_mapeo;
+    nota_t *notas;            // Primera nota dentro del mapeo completo
+    int con_claves;           // 1 si el archivo trae una clave por nota
+    uint32_t secciones;       // Rango de las claves según la cabecera (0 si no se sabe)
+    clave_t *claves;          // Primera clave dentro del mapeo completo (NULL si no hay)
+} archivo_notas;
+
+/* Porción del archivo mapeada por un trabajador en modo ventana */
+typedef struct {
+    void *base;
+    size_t bytes;
+} ventana;
+
+/*
+ * Abre ruta y valida la cabecera (magia, versión, tamaño de nota igual al de
+ * este binario y tamaño del archivo). completo: 1 para mapear todo el archivo
+ * con MAP_POPULATE y MADV_SEQUENTIAL; 0 para leerlo luego por ventanas.
+ * Retorna 0 o -1 (con el motivo en stderr).
+ */
+int archivo_abrir(archivo_notas *a, const char *ruta, int completo);
+
+/*
+ * Los kernels cuentan en la misma pasada las notas fuera de [0, MAX_NOTA]
+ * (ver clasificar()): si fuera no es cero lo reporta para ruta y retorna -1,
+ * y el motor descarta la corrida sin informe ni historial; si no, retorna 0.
+ */
+int archivo_fuera_de_rango(const char *ruta, long long fuera);
+
+/*
+ * Mapea solo las notas [inicio, inicio + cantidad) del archivo (desde el límite
+ * de página anterior) y retorna un puntero a la primera; NULL si falla.
+ * La memoria residente queda acotada al tamaño de las ventanas abiertas.
+ * Las páginas se prefallan con MAP_POPULATE (sin madvise: la ventana se lee
+ * completa enseguida y ya está residente cuando retorna).
+ */
+const nota_t *archivo_ventana(const archivo_notas *a, long inicio, long cantidad, ventana *v);
+
+/* Desmapea una ventana */
+void ventana_liberar(ventana *v);
+
+/* Desmapea y cierra el archivo */
+void archivo_cerrar(archivo_notas *a);
+
+/*
+ * Escribe en ruta un archivo con cantidad notas generadas con semilla,
+ * por partes para no tener el arreglo completo en memoria. Si secciones > 0
+ * agrega una clave generada por nota, entre 0 y secciones - 1.
+ * Retorna 0 o -1 (con errno).
+ */
+int archivo_exportar(const char *ruta, long cantidad, uint64_t semilla, uint32_t secciones);
+
+#endif
@@ -0,0 +1,33 @@
+#include "barrido.h"
+
+#include <stdio.h>
+
+int barrido_niveles(int max, int *niveles)
+{
+    int n = 0;
+    for (int p = 1; p < max; p *= 2)
+        niveles[n++] = p;
+    niveles[n++] = max;
+    return n;
+}
+
+void barrido_imprimir(const char *titulo, const int *niveles, const double *tiempos,
+                      const double *esperas, int n)
+{
+    printf("\n=== Barrido de escalado (%s) ===\n", titulo);
+    printf("%10s | %12s | %8s | %10s | %11s", "Trabajad.", "Tiempo (s)", "Speedup", "Eficiencia", "Karp-Flatt");
+    printf(esperas ? " | %16s\n" : "\n", "Espera agr. (us)");
+    double t1 = tiempos[0];   // Referencia: niveles[0] siempre es un trabajador
+    for (int i = 0; i < n; ++i) {
+        int p = niveles[i];
+        double s = tiempos[i] > 0 ? t1 / tiempos[i] : 0.0;
+        printf("%10d | %12.6f | %8.2f | %9.1f%% |", p, tiempos[i], s, 100.0 * s / p);
+        if (p > 1 && s > 0)
+            printf(" %11.4f", (1.0 / s - 1.0 / p) / (1.0 - 1.0 / p));
+        else
+            printf(" %11s", "-");
+        if (esperas)
+            printf(" | %16.3f", 1e6 * esperas[i]);
+        printf("\n");
+    }
+}
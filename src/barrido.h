@@ -0,0 +1,20 @@
+#ifndef BARRIDO_H
+#define BARRIDO_H
+
+/*
+ * Niveles del barrido de escalado: 1, 2, 4, ... hasta max, incluyendo
+ * siempre max aunque no sea potencia de 2. niveles debe tener espacio para
+ * al menos 33 enteros. Retorna cuántos niveles se escribieron.
+ */
+int barrido_niveles(int max, int *niveles);
+
+/*
+ * Imprime la tabla del barrido: tiempo, speedup S = T1/Tp, eficiencia S/p y
+ * fracción serial de Karp-Flatt e = (1/S - 1/p) / (1 - 1/p).
+ * titulo: nombre del motor, niveles/tiempos: n filas medidas.
+ * esperas: espera máxima de un trabajador en la agregación por nivel (puede ser NULL).
+ */
+void barrido_imprimir(const char *titulo, const int *niveles, const double *tiempos,
+                      const double *esperas, int n);
+
+#endif
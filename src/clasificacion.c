@@ -0,0 +1,180 @@
+#include "clasificacion.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+/* Kernel usado por clasificar(); se fija en seleccionar_kernel() */
+static void kernel_ramas(const nota_t *notas, long cantidad, conteo *c);
+static void (*kernel_actual)(const nota_t *, long, conteo *) = kernel_ramas;
+
+/*
+ * Bucle original de procesar(): una rama por categoría.
+ * Es la referencia contra la que se comparan los demás kernels.
+ */
+static void kernel_ramas(const nota_t *notas, long cantidad, conteo *c)
+{
+    long long suma = 0, rep = 0, ab = 0, aa = 0, fuera = 0;
+    for (long i = 0; i < cantidad; ++i) {
+        int n = notas[i];
+        suma += n;
+        if (n < 18) rep++;
+        else if (n < 28) ab++;
+        else aa++;
+        if ((unsigned)n > MAX_NOTA) fuera++;
+    }
+    c->suma += suma;
+    c->reprobados += rep;
+    c->aprobado_bajo += ab;
+    c->aprobado_alto += aa;
+    c->fuera += fuera;
+}
+
+/*
+ * Versión sin ramas: las comparaciones se suman como 0/1.
+ * aprobado_bajo se deduce del total para no contar tres veces.
+ */
+static void kernel_escalar(const nota_t *notas, long cantidad, conteo *c)
+{
+    long long suma = 0, rep = 0, aa = 0, fuera = 0;
+    for (long i = 0; i < cantidad; ++i) {
+        int n = notas[i];
+        suma += n;
+        rep += n < 18;
+        aa  += n >= 28;
+        fuera += (unsigned)n > MAX_NOTA;
+    }
+    c->suma += suma;
+    c->reprobados += rep;
+    c->aprobado_bajo += cantidad - rep - aa;
+    c->aprobado_alto += aa;
+    c->fuera += fuera;
+}
+
+#if defined(KERNELS_X86) && !defined(NOTAS_INT32)
+/* Notas fuera de [0, MAX_NOTA] en notas[0 .. cantidad): solo cuando el máximo del bloque lo indica */
+static long long contar_fuera(const nota_t *notas, long cantidad)
+{
+    long long fuera = 0;
+    for (long i = 0; i < cantidad; ++i) fuera += notas[i] > MAX_NOTA;
+    return fuera;
+}
+
+/*
+ * Kernels vectoriales para notas de un byte. Por cada vector:
+ *  - la suma se obtiene con SAD contra cero (suma horizontal de 8 bytes a 64 bits);
+ *  - cada comparación da 0xFF (-1) por byte, así que restarla cuenta +1 por nota.
+ * Los contadores por byte se vacían con SAD cada 255 vectores para no desbordar.
+ * Como MAX_NOTA < 128 la comparación con signo de epi8 es válida para las notas
+ * en rango. Para las de fuera basta una instrucción más por vector: el máximo sin
+ * signo de todos los bytes. Solo si supera MAX_NOTA (un archivo ajeno, que la
+ * corrida rechaza) se vuelven a contar una por una.
+ */
+__attribute__((target("sse4.1")))
+static void kernel_sse4(const nota_t *notas, long cantidad, conteo *c)
+{
+    const __m128i cero = _mm_setzero_si128();
+    const __m128i lim_rep  = _mm_set1_epi8(18);   // n < 18  <=> 18 > n
+    const __m128i lim_alto = _mm_set1_epi8(27);   // n >= 28 <=> n > 27
+    const __m128i lim_fuera = _mm_set1_epi8(MAX_NOTA);
+    __m128i suma = cero, rep = cero, alto = cero, maximo = cero;
+    long i = 0;
+    while (cantidad - i >= 16) {
+        long vectores = (cantidad - i) / 16;
+        if (vectores > 255) vectores = 255;
+        __m128i rep8 = cero, alto8 = cero;
+        for (long v = 0; v < vectores; ++v, i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(notas + i));
+            maximo = _mm_max_epu8(maximo, x);
+            suma  = _mm_add_epi64(suma, _mm_sad_epu8(x, cero));
+            rep8  = _mm_sub_epi8(rep8, _mm_cmpgt_epi8(lim_rep, x));
+            alto8 = _mm_sub_epi8(alto8, _mm_cmpgt_epi8(x, lim_alto));
+        }
+        rep  = _mm_add_epi64(rep, _mm_sad_epu8(rep8, cero));
+        alto = _mm_add_epi64(alto, _mm_sad_epu8(alto8, cero));
+    }
+    long long r = _mm_extract_epi64(rep, 0) + _mm_extract_epi64(rep, 1);
+    long long a = _mm_extract_epi64(alto, 0) + _mm_extract_epi64(alto, 1);
+    c->suma += _mm_extract_epi64(suma, 0) + _mm_extract_epi64(suma, 1);
+    c->reprobados += r;
+    c->aprobado_bajo += i - r - a;
+    c->aprobado_alto += a;
+    // Algún byte mayor que MAX_NOTA: max(maximo, MAX_NOTA) difiere de MAX_NOTA
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(maximo, lim_fuera), lim_fuera)) != 0xFFFF)
+        c->fuera += contar_fuera(notas, i);
+    kernel_escalar(notas + i, cantidad - i, c);   // Cola de menos de 16 notas
+}
+
+__attribute__((target("avx2")))
+static void kernel_avx2(const nota_t *notas, long cantidad, conteo *c)
+{
+    const __m256i cero = _mm256_setzero_si256();
+    const __m256i lim_rep  = _mm256_set1_epi8(18);
+    const __m256i lim_alto = _mm256_set1_epi8(27);
+    const __m256i lim_fuera = _mm256_set1_epi8(MAX_NOTA);
+    __m256i suma = cero, rep = cero, alto = cero, maximo = cero;
+    long i = 0;
+    while (cantidad - i >= 32) {
+        long vectores = (cantidad - i) / 32;
+        if (vectores > 255) vectores = 255;
+        __m256i rep8 = cero, alto8 = cero;
+        for (long v = 0; v < vectores; ++v, i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(notas + i));
+            maximo = _mm256_max_epu8(maximo, x);
+            suma  = _mm256_add_epi64(suma, _mm256_sad_epu8(x, cero));
+            rep8  = _mm256_sub_epi8(rep8, _mm256_cmpgt_epi8(lim_rep, x));
+            alto8 = _mm256_sub_epi8(alto8, _mm256_cmpgt_epi8(x, lim_alto));
+        }
+        rep  = _mm256_add_epi64(rep, _mm256_sad_epu8(rep8, cero));
+        alto = _mm256_add_epi64(alto, _mm256_sad_epu8(alto8, cero));
+    }
+    long long s[4], r[4], a[4];
+    _mm256_storeu_si256((__m256i *)s, suma);
+    _mm256_storeu_si256((__m256i *)r, rep);
+    _mm256_storeu_si256((__m256i *)a, alto);
+    long long rt = r[0] + r[1] + r[2] + r[3];
+    long long at = a[0] + a[1] + a[2] + a[3];
+    c->suma += s[0] + s[1] + s[2] + s[3];
+    c->reprobados += rt;
+    c->aprobado_bajo += i - rt - at;
+    c->aprobado_alto += at;
+    if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(maximo, lim_fuera), lim_fuera)) != 0xFFFFFFFFu)
+        c->fuera += contar_fuera(notas, i);
+    kernel_escalar(notas + i, cantidad - i, c);   // Cola de menos de 32 notas
+}
+#endif
+
+const char *seleccionar_kernel(const char *nombre)
+{
+    int automatico = !nombre || strcmp(nombre, "auto") == 0;
+#if defined(KERNELS_X86) && !defined(NOTAS_INT32)
+    __builtin_cpu_init();
+    if (automatico ? __builtin_cpu_supports("avx2") : strcmp(nombre, "avx2") == 0) {
+        if (!__builtin_cpu_supports("avx2")) return NULL;
+        kernel_actual = kernel_avx2;
+        return "avx2";
+    }
+    if (automatico ? __builtin_cpu_supports("sse4.1") : strcmp(nombre, "sse4") == 0) {
+        if (!__builtin_cpu_supports("sse4.1")) return NULL;
+        kernel_actual = kernel_sse4;
+        return "sse4";
+    }
+#endif
+    if (automatico || strcmp(nombre, "escalar") == 0) {
+        kernel_actual = kernel_escalar;
+        return "escalar";
+    }
+    if (strcmp(nombre, "ramas") == 0) {
+        kernel_actual = kernel_ramas;
+        return "ramas";
+    }
+    return NULL;
+}
+
+void clasificar(const nota_t *notas, long cantidad, conteo *c)
+{
+    kernel_actual(notas, cantidad, c);
+}
@@ -0,0 +1,32 @@
+#ifndef CLASIFICACION_H
+#define CLASIFICACION_H
+
+#include "comun.h"
+
+/* Acumulado de un bloque de notas: suma y las tres categorías */
+typedef struct {
+    long long suma;          // Suma de las notas
+    long long reprobados;    // Notas < 18
+    long long aprobado_bajo; // Notas 18-27
+    long long aprobado_alto; // Notas 28-40
+    long long fuera;         // Notas fuera de [0, MAX_NOTA] (un archivo ajeno): si hay, lo demás no vale
+} conteo;
+
+/*
+ * Elige el kernel de clasificación. nombre puede ser "auto" (o NULL), "ramas"
+ * (el bucle if/else original), "escalar", "sse4" o "avx2". Con "auto" se
+ * detecta la CPU y se usa el más ancho disponible. Retorna el nombre del
+ * kernel elegido o NULL si el pedido no existe o la CPU no lo soporta.
+ * Debe llamarse una vez antes de crear hilos o procesos.
+ */
+const char *seleccionar_kernel(const char *nombre);
+
+/*
+ * Suma y clasifica notas[0 .. cantidad) con el kernel seleccionado y
+ * acumula en c. Todos los kernels dan exactamente el mismo resultado y
+ * cuentan en la misma pasada las notas fuera de rango: los motores no
+ * validan el archivo aparte y rechazan la corrida si c->fuera no es cero.
+ */
+void clasificar(const nota_t *notas, long cantidad, conteo *c);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef COMUN_H
+#define COMUN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Parámetros compartidos por ambos motores (hilos y procesos) */
+#define TOTAL_NOTAS 20000000   // Total de notas a procesar
+#define MAX_NOTA    40         // Nota máxima posible
+
+/*
+ * Tipo de almacenamiento de cada nota. Como MAX_NOTA cabe en un byte, por
+ * defecto se usa uint8_t (20 MB en lugar de 80 MB); compilando con
+ * -DNOTAS_INT32 se vuelve al arreglo de int original para comparar.
+ */
+#ifdef NOTAS_INT32
+typedef int nota_t;
+#else
+typedef uint8_t nota_t;
+#endif
+
+/*
+ * Clave de agrupación de cada nota (sección, curso...), para --agrupar.
+ * El valor CLAVE_VACIA está reservado: marca los lugares libres de las tablas.
+ */
+typedef uint32_t clave_t;
+#define CLAVE_VACIA UINT32_MAX
+
+/*
+ * Diferencia en segundos entre dos marcas de tiempo.
+ * a: marca inicial, b: marca final.
+ */
+static inline double segundos_entre(struct timespec a, struct timespec b)
+{
+    return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+/*
+ * Etiqueta de un grupo al estilo de columnas de hoja de cálculo:
+ * 0 -> "A", 25 -> "Z", 26 -> "AA", 27 -> "AB", ...
+ * buf debe tener al menos ETIQUETA_MAX bytes.
+ */
+#define ETIQUETA_MAX 8
+static inline char *etiqueta_grupo(int i, char *buf)
+{
+    char tmp[ETIQUETA_MAX];
+    int n = 0;
+    do {
+        tmp[n++] = 'A' + i % 26;
+        i = i / 26 - 1;
+    } while (i >= 0 && n < ETIQUETA_MAX - 1);
+    for (int k = 0; k < n; ++k) buf[k] = tmp[n - 1 - k];
+    buf[n] = '\0';
+    return buf;
+}
+
+/*
+ * Ancho de banda efectivo en GB/s al recorrer cantidad notas en tiempo segundos.
+ */
+static inline double gbps(long cantidad, double tiempo)
+{
+    return tiempo > 0 ? cantidad * (double)sizeof(nota_t) / tiempo / 1e9 : 0.0;
+}
+
+/*
+ * Duración en segundos de cada fase de una corrida, con los mismos límites en
+ * ambos motores: lanzamiento (crear los trabajadores), generación (hasta que
+ * todos tienen su tramo listo), cómputo (hasta que el último termina su último
+ * bloque), reducción (totales globales y join/wait) y reporte (archivo e impresión).
+ */
+typedef struct {
+    double lanzamiento;
+    double generacion;
+    double computo;
+    double reduccion;
+    double reporte;
+} fases;
+
+/*
+ * Imprime las fases en una sola línea "clave=valor" que también lee run.c.
+ */
+static inline void imprimir_fases(const fases *f)
+{
+    printf("Fases (s): lanzamiento=%.6f generacion=%.6f computo=%.6f reduccion=%.6f reporte=%.6f\n",
+           f->lanzamiento, f->generacion, f->computo, f->reduccion, f->reporte);
+}
+
+#endif
@@ -0,0 +1,126 @@
+#define _GNU_SOURCE
+#include "contadores.h"
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "comun.h"
+
+/* Tipo y configuración de cada evento, en el orden de HW_* */
+static const struct {
+    uint32_t tipo;
+    uint64_t config;
+} eventos[N_EVENTOS_HW] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+/* Abre un evento del hilo que llama, detenido; -1 si no se puede */
+static int abrir_evento(uint32_t tipo, uint64_t config)
+{
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = tipo;
+    a.config = config;
+    a.disabled = 1;
+    a.exclude_kernel = 1;     // Alcanza con perf_event_paranoid <= 2
+    a.exclude_hv = 1;
+    // Cada evento va solo (sin grupo): si hay más eventos que contadores el núcleo los
+    // reparte en el tiempo y estos dos tiempos permiten escalar la cuenta
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+
+void contadores_iniciar(contadores *c)
+{
+    for (int k = 0; k < N_EVENTOS_HW; ++k) {
+        c->fd[k] = abrir_evento(eventos[k].tipo, eventos[k].config);
+        if (c->fd[k] >= 0) ioctl(c->fd[k], PERF_EVENT_IOC_RESET, 0);
+    }
+    getrusage(RUSAGE_THREAD, &c->antes);
+    for (int k = 0; k < N_EVENTOS_HW; ++k)
+        if (c->fd[k] >= 0) ioctl(c->fd[k], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void contadores_detener(contadores *c, medicion_hw *m)
+{
+    for (int k = 0; k < N_EVENTOS_HW; ++k)
+        if (c->fd[k] >= 0) ioctl(c->fd[k], PERF_EVENT_IOC_DISABLE, 0);
+    struct rusage despues;
+    getrusage(RUSAGE_THREAD, &despues);
+    for (int k = 0; k < N_EVENTOS_HW; ++k) {
+        m->hw[k] = -1;
+        if (c->fd[k] < 0) continue;
+        uint64_t lectura[3];   // Valor, tiempo habilitado y tiempo contando
+        if (read(c->fd[k], lectura, sizeof(lectura)) == (ssize_t)sizeof(lectura) && lectura[2] > 0)
+            m->hw[k] = (long long)((double)lectura[0] * lectura[1] / lectura[2]);
+        close(c->fd[k]);
+        c->fd[k] = -1;
+    }
+    m->fallos_menores        = despues.ru_minflt - c->antes.ru_minflt;
+    m->fallos_mayores        = despues.ru_majflt - c->antes.ru_majflt;
+    m->cambios_voluntarios   = despues.ru_nvcsw - c->antes.ru_nvcsw;
+    m->cambios_involuntarios = despues.ru_nivcsw - c->antes.ru_nivcsw;
+}
+
+/* Escribe v en buf, o "n/d" si el evento no estuvo disponible */
+static const char *cuenta(long long v, char *buf, size_t n)
+{
+    if (v < 0) snprintf(buf, n, "n/d");
+    else snprintf(buf, n, "%lld", v);
+    return buf;
+}
+
+/* Imprime la línea de una medición con la etiqueta dada */
+static void imprimir_medicion(const char *etiqueta, const medicion_hw *m, long notas)
+{
+    char llc[24], rama[24], dtlb[24];
+    long long ciclos = m->hw[HW_CICLOS], instr = m->hw[HW_INSTRUCCIONES];
+    printf("%s | ", etiqueta);
+    if (ciclos > 0 && instr >= 0) printf("IPC: %.2f | ", (double)instr / ciclos);
+    else printf("IPC: n/d | ");
+    if (ciclos >= 0 && notas > 0) printf("Ciclos/nota: %.3f | ", (double)ciclos / notas);
+    else printf("Ciclos/nota: n/d | ");
+    printf("Fallos LLC: %s | Fallos de predicción: %s | Fallos dTLB: %s | ",
+           cuenta(m->hw[HW_FALLOS_LLC], llc, sizeof(llc)), cuenta(m->hw[HW_FALLOS_RAMA], rama, sizeof(rama)),
+           cuenta(m->hw[HW_FALLOS_DTLB], dtlb, sizeof(dtlb)));
+    printf("Fallos de página: %ld menores, %ld mayores | Cambios de contexto: %ld voluntarios, %ld involuntarios\n",
+           m->fallos_menores, m->fallos_mayores, m->cambios_voluntarios, m->cambios_involuntarios);
+}
+
+void contadores_imprimir(const medicion_hw *m, const long *notas, int n)
+{
+    medicion_hw total = {0};
+    long notas_total = 0;
+    int disponibles = 0;
+    printf("\n=== Contadores por trabajador ===\n");
+    for (int i = 0; i < n; ++i) {
+        char etiqueta[ETIQUETA_MAX + 8], letra[ETIQUETA_MAX];
+        snprintf(etiqueta, sizeof(etiqueta), "Grupo %s", etiqueta_grupo(i, letra));
+        imprimir_medicion(etiqueta, &m[i], notas[i]);
+        // Un evento entra en el total solo si todos los trabajadores lo midieron
+        for (int k = 0; k < N_EVENTOS_HW; ++k)
+            total.hw[k] = (i == 0 || total.hw[k] >= 0) && m[i].hw[k] >= 0 ? total.hw[k] + m[i].hw[k] : -1;
+        total.fallos_menores        += m[i].fallos_menores;
+        total.fallos_mayores        += m[i].fallos_mayores;
+        total.cambios_voluntarios   += m[i].cambios_voluntarios;
+        total.cambios_involuntarios += m[i].cambios_involuntarios;
+        notas_total += notas[i];
+    }
+    imprimir_medicion("Total", &total, notas_total);
+    for (int k = 0; k < N_EVENTOS_HW; ++k) disponibles += total.hw[k] >= 0;
+    if (disponibles < N_EVENTOS_HW)
+        printf("Eventos n/d: perf_event_open no los ofrece (revise /proc/sys/kernel/perf_event_paranoid "
+               "o si la máquina virtual expone la PMU)\n");
+}
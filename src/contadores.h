@@ -0,0 +1,51 @@
+#ifndef CONTADORES_H
+#define CONTADORES_H
+
+#include <sys/resource.h>
+
+/* Eventos de hardware que se miden por trabajador con perf_event_open */
+enum {
+    HW_CICLOS,
+    HW_INSTRUCCIONES,
+    HW_FALLOS_LLC,            // Lecturas que fallan en la caché de último nivel
+    HW_FALLOS_RAMA,           // Saltos mal predichos
+    HW_FALLOS_DTLB,           // Lecturas que fallan en la TLB de datos
+    N_EVENTOS_HW
+};
+
+/*
+ * Lo que midió un trabajador en su bucle principal. Sin punteros: los hijos de
+ * procesos.c lo dejan en memoria compartida.
+ */
+typedef struct {
+    long long hw[N_EVENTOS_HW];   // -1 si el evento no está disponible (permisos, sin PMU o máquina virtual)
+    long fallos_menores;          // Fallos de página sin E/S (p. ej. copia en escritura tras fork)
+    long fallos_mayores;          // Fallos de página que leyeron del disco
+    long cambios_voluntarios;     // Cambios de contexto por esperar (barreras, E/S)
+    long cambios_involuntarios;   // Cambios de contexto por expropiación del planificador
+} medicion_hw;
+
+/* Contadores abiertos para el hilo que los inició */
+typedef struct {
+    int fd[N_EVENTOS_HW];         // -1 si el evento no se pudo abrir
+    struct rusage antes;
+} contadores;
+
+/*
+ * Abre los contadores del hilo que llama (solo espacio de usuario), los pone
+ * en cero y los arranca junto con la foto de getrusage(RUSAGE_THREAD).
+ * Los eventos que no se pueden abrir quedan fuera sin afectar a los demás.
+ */
+void contadores_iniciar(contadores *c);
+
+/* Detiene y cierra los contadores y deja en m lo ocurrido desde contadores_iniciar() */
+void contadores_detener(contadores *c, medicion_hw *m);
+
+/*
+ * Imprime una línea por trabajador (IPC, ciclos por nota, fallos de LLC, de
+ * predicción, de dTLB y de página, y cambios de contexto) y el total.
+ * notas[i]: notas que procesó el trabajador i.
+ */
+void contadores_imprimir(const medicion_hw *m, const long *notas, int n);
+
+#endif
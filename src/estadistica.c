@@ -0,0 +1,69 @@
+#include "estadistica.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* Valores críticos bilaterales al 95% para 1..30 grados de libertad */
+static const double tabla_t[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static int comparar(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double percentil(const double *ordenadas, int n, double p)
+{
+    double pos = p * (n - 1);
+    int i = (int)pos;
+    if (i >= n - 1) return ordenadas[n - 1];
+    return ordenadas[i] + (pos - i) * (ordenadas[i + 1] - ordenadas[i]);
+}
+
+void resumir(double *muestras, int n, resumen_muestras *r)
+{
+    r->n = n;
+    if (n == 0) {
+        r->media = r->desviacion = r->mediana = r->p95 = r->minimo = r->maximo = r->ic95 = 0;
+        return;
+    }
+    qsort(muestras, n, sizeof(double), comparar);
+    double suma = 0;
+    for (int i = 0; i < n; ++i) suma += muestras[i];
+    r->media = suma / n;
+    double cuadrados = 0;
+    for (int i = 0; i < n; ++i) cuadrados += (muestras[i] - r->media) * (muestras[i] - r->media);
+    r->desviacion = n > 1 ? sqrt(cuadrados / (n - 1)) : 0;
+    r->mediana = percentil(muestras, n, 0.5);
+    r->p95     = percentil(muestras, n, 0.95);
+    r->minimo  = muestras[0];
+    r->maximo  = muestras[n - 1];
+    r->ic95    = n > 1 ? t_critico(n - 1) * r->desviacion / sqrt(n) : 0;
+}
+
+double t_critico(double gl)
+{
+    if (gl < 1) return tabla_t[0];
+    if (gl <= 30) return tabla_t[(int)gl - 1];   // Redondea hacia abajo: más conservador
+    return 1.960 + 2.4 / gl;                     // Aproxima 2.021 (40), 2.000 (60), 1.980 (120)
+}
+
+int welch(const resumen_muestras *a, const resumen_muestras *b, double *t, double *gl)
+{
+    if (a->n < 2 || b->n < 2) return -1;
+    double va = a->desviacion * a->desviacion / a->n;
+    double vb = b->desviacion * b->desviacion / b->n;
+    if (va + vb == 0) {
+        // Sin variación en ninguna serie: cualquier diferencia es exacta
+        *t = a->media == b->media ? 0 : (a->media > b->media ? INFINITY : -INFINITY);
+        *gl = a->n + b->n - 2;
+        return a->media != b->media;
+    }
+    *t  = (a->media - b->media) / sqrt(va + vb);
+    *gl = (va + vb) * (va + vb) / (va * va / (a->n - 1) + vb * vb / (b->n - 1));
+    return fabs(*t) > t_critico(*gl);
+}
@@ -0,0 +1,38 @@
+#ifndef ESTADISTICA_H
+#define ESTADISTICA_H
+
+/* Resumen de una serie de mediciones (en segundos) */
+typedef struct {
+    int n;              // Cantidad de muestras
+    double media;
+    double desviacion;  // Desviación estándar muestral (n - 1)
+    double mediana;
+    double p95;         // Percentil 95 (interpolación lineal)
+    double minimo, maximo;
+    double ic95;        // Semiancho del intervalo de confianza al 95% de la media (t de Student)
+} resumen_muestras;
+
+/*
+ * Calcula el resumen de n muestras. Ordena el arreglo muestras en el lugar.
+ */
+void resumir(double *muestras, int n, resumen_muestras *r);
+
+/*
+ * Percentil p (0..1) de n valores ya ordenados, interpolando entre vecinos.
+ */
+double percentil(const double *ordenadas, int n, double p);
+
+/*
+ * Valor crítico bilateral al 95% de la t de Student con gl grados de libertad.
+ */
+double t_critico(double gl);
+
+/*
+ * Prueba t de Welch (varianzas distintas) entre dos series.
+ * t, gl: estadístico y grados de libertad de Welch-Satterthwaite.
+ * Retorna 1 si la diferencia de medias es significativa al 95%, 0 si no y
+ * -1 si alguna serie tiene menos de 2 muestras.
+ */
+int welch(const resumen_muestras *a, const resumen_muestras *b, double *t, double *gl);
+
+#endif
@@ -0,0 +1,60 @@
+#include "generador.h"
+#include "comun.h"
+
+#define PHI64 0x9E3779B97F4A7C15ULL   // Incremento de splitmix64 (razón áurea)
+#define SAL_CLAVES 0x636C61766573ULL  // Separa la secuencia de claves de la de notas ("claves")
+
+/*
+ * Finalizador de splitmix64: convierte un contador en 64 bits pseudoaleatorios.
+ */
+static inline uint64_t mezclar64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/*
+ * Reduce 32 bits aleatorios al rango [0, MAX_NOTA] con multiplicación y
+ * desplazamiento (sin el sesgo ni la división de '%').
+ */
+static inline nota_t a_nota(uint32_t r)
+{
+    return (nota_t)(((uint64_t)r * (MAX_NOTA + 1)) >> 32);
+}
+
+/*
+ * Cada salida de 64 bits del contador k produce dos notas: la posición 2k
+ * usa la mitad alta y la 2k+1 la mitad baja.
+ */
+void generar_notas_en(nota_t *destino, long inicio, long cantidad, uint64_t semilla)
+{
+    uint64_t base = mezclar64(semilla);   // Separa semillas consecutivas
+    long i = inicio, fin = inicio + cantidad;
+    nota_t *d = destino;                  // d[0] es la posición inicio
+    if (i < fin && (i & 1)) {             // Posición impar inicial
+        *d++ = a_nota((uint32_t)mezclar64(base + (uint64_t)(i >> 1) * PHI64));
+        ++i;
+    }
+    for (; i + 1 < fin; i += 2, d += 2) {
+        uint64_t r = mezclar64(base + (uint64_t)(i >> 1) * PHI64);
+        d[0] = a_nota((uint32_t)(r >> 32));
+        d[1] = a_nota((uint32_t)r);
+    }
+    if (i < fin)                          // Posición par final
+        *d = a_nota((uint32_t)(mezclar64(base + (uint64_t)(i >> 1) * PHI64) >> 32));
+}
+
+void generar_notas(nota_t *notas, long inicio, long cantidad, uint64_t semilla)
+{
+    generar_notas_en(notas + inicio, inicio, cantidad, semilla);
+}
+
+void generar_claves_en(clave_t *destino, long inicio, long cantidad, uint64_t semilla, uint32_t secciones)
+{
+    uint64_t base = mezclar64(semilla ^ SAL_CLAVES);
+    for (long i = 0; i < cantidad; ++i) {
+        uint32_t r = (uint32_t)mezclar64(base + (uint64_t)(inicio + i) * PHI64);
+        destino[i] = (clave_t)(((uint64_t)r * secciones) >> 32);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+
+#include <stdint.h>
+
+#include "comun.h"
+
+/*
+ * Llena notas[inicio .. inicio+cantidad) con notas entre 0 y MAX_NOTA.
+ * El generador es por contador: la nota de la posición i depende solo de
+ * (semilla, i), así que cualquier reparto entre hilos o procesos produce
+ * exactamente el mismo arreglo para la misma semilla.
+ */
+void generar_notas(nota_t *notas, long inicio, long cantidad, uint64_t semilla);
+
+/*
+ * Igual que generar_notas, pero escribe las notas de las posiciones
+ * inicio .. inicio+cantidad en destino[0 .. cantidad), p. ej. en un búfer
+ * que se vuelca a un archivo por partes.
+ */
+void generar_notas_en(nota_t *destino, long inicio, long cantidad, uint64_t semilla);
+
+/*
+ * Llena destino[0 .. cantidad) con las claves de las posiciones
+ * inicio .. inicio+cantidad, uniformes en [0, secciones). Como las notas,
+ * dependen solo de (semilla, posición), pero salen de otra secuencia.
+ */
+void generar_claves_en(clave_t *destino, long inicio, long cantidad, uint64_t semilla, uint32_t secciones);
+
+#endif
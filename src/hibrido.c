@@ -0,0 +1,471 @@
+#define _GNU_SOURCE   /* sched_getcpu */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "comun.h"
+#include "afinidad.h"
+#include "agregacion.h"
+#include "archivo.h"
+#include "clasificacion.h"
+#include "contadores.h"
+#include "generador.h"
+#include "hijos.h"
+#include "histograma.h"
+#include "opciones.h"
+#include "planificador.h"
+#include "registro.h"
+
+/*
+ * Motor híbrido: P procesos hijos, cada uno con T hilos, sobre notas en memoria
+ * compartida. La reducción es jerárquica: cada hilo cuenta en variables propias,
+ * cada proceso suma a sus hilos sin compartir nada con los demás procesos y solo
+ * esa suma por proceso pasa por el agregador global en memoria compartida.
+ */
+
+/* Resultado de un hilo (cada uno en su línea de caché para no compartirla) */
+typedef struct {
+    _Alignas(LINEA_CACHE) double promedio; // Promedio de notas del hilo
+    histograma hist;         // Histograma de lo procesado (--histograma)
+    conteo c;                // Suma y categorías de lo procesado
+    long cantidad;           // Notas procesadas por el hilo
+    double tiempo;           // Tiempo de ejecución del hilo en segundos
+    int bloques;             // Bloques procesados (propios y robados)
+    double busqueda;         // Tiempo buscando bloques que robar
+    struct timespec fin;     // Momento en que terminó su último bloque (reloj común a todos)
+    double inactivo;         // Tiempo sin trabajo: esperando al último hilo o buscando bloques
+    int cpu;                 // CPU en la que terminó (para el ancho de banda por nodo)
+    medicion_hw hw;          // Contadores de su bucle (--contadores)
+} resultado_hilo;
+
+/* Resultado de un proceso: la reducción de sus hilos */
+typedef struct {
+    _Alignas(LINEA_CACHE) histograma hist; // Suma de los histogramas de sus hilos (--histograma)
+    conteo c;                // Suma de los conteos de sus hilos
+    long cantidad;           // Notas procesadas por sus hilos
+    double reduccion;        // Desde que terminó su último hilo hasta dejar su suma en el agregador
+    double espera;           // Tiempo en la agregación de totales globales
+    long fallos;             // Fallos de página menores del proceso durante el cómputo
+} resultado_proceso;
+
+/* Arranque común a todos los hilos de todos los procesos y al padre */
+typedef struct {
+    pthread_barrier_t barrera;  // Todos los hilos + el padre
+    _Atomic int llegados;       // Hilos que llegaron a la barrera (ver hijos_esperar_llegadas)
+} arranque;
+
+/* Recursos del padre, en memoria compartida anónima que los hijos heredan con fork() */
+typedef struct {
+    nota_t *notas;              // Notas compartidas (generadas por los hilos o el archivo mapeado)
+    long total;                 // Notas a procesar
+    int n_procesos;             // P
+    int n_hilos;                // Hilos en total (P × T, repartidos entre los procesos)
+    int generar;                // 1: cada hilo genera su tramo antes de procesarlo
+    uint64_t semilla;           // Semilla de la generación
+    int histograma;             // 1: cada hilo arma el histograma de sus notas
+    int contadores;             // 1: cada hilo mide su bucle con perf_event_open y getrusage
+    const afinidad *afin;       // Política de afinidad que aplica cada hilo al comenzar
+    planificador *plan;         // Reparte los bloques entre todos los hilos de todos los procesos
+    agregador *totales;         // Totales globales: una ranura por proceso
+    arranque *inicio;           // Barrera de arranque y sus llegadas
+    resultado_hilo *hilos;      // Un resultado por hilo
+    resultado_proceso *procesos; // Un resultado por proceso
+} recursos;
+
+/* Datos pasados a cada hilo de un proceso */
+typedef struct {
+    int id;                     // Índice global del hilo (0..n_hilos-1)
+    const recursos *r;
+} dato_hilo;
+
+/* Primer hilo del proceso p: los hilos se reparten en tramos contiguos de índices */
+static int primer_hilo(const recursos *r, int p)
+{
+    return (int)((long)r->n_hilos * p / r->n_procesos);
+}
+
+/* Reserva bytes de memoria compartida anónima (la heredan los hijos); NULL si falla */
+static void *compartida(size_t bytes)
+{
+    void *m = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return m == MAP_FAILED ? NULL : m;
+}
+
+/* Fallos de página menores acumulados de quien (RUSAGE_SELF o RUSAGE_CHILDREN) */
+static long fallos_menores(int quien)
+{
+    struct rusage uso;
+    getrusage(quien, &uso);
+    return uso.ru_minflt;
+}
+
+/*
+ * Función que ejecuta cada hilo: se fija a su CPU, genera su tramo (primer toque
+ * en su nodo NUMA), espera en la barrera común a todos los procesos y procesa los
+ * bloques que le entrega el planificador. Primer nivel de la reducción: cuenta en
+ * variables propias y solo al final deja el resultado en su celda.
+ */
+static void *procesar(void *arg)
+{
+    const dato_hilo *info = arg;
+    const recursos *r = info->r;
+    resultado_hilo *res = &r->hilos[info->id];
+    afinidad_fijar(r->afin, info->id);
+    if (r->generar) {
+        long inicio, cantidad;
+        planificador_tramo(r->plan, info->id, &inicio, &cantidad);
+        generar_notas(r->notas, inicio, cantidad, r->semilla);
+    }
+    atomic_fetch_add_explicit(&r->inicio->llegados, 1, memory_order_release);
+    pthread_barrier_wait(&r->inicio->barrera); // Todos los tramos listos antes de medir
+    pthread_barrier_wait(&r->inicio->barrera); // El padre ya marcó el inicio
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    conteo c = {0};
+    histograma h = {0};
+    long inicio, tam, cantidad = 0;
+    int bloques = 0;
+    double busqueda = 0;
+    contadores cnt;
+    if (r->contadores) contadores_iniciar(&cnt);
+    while (planificador_siguiente(r->plan, info->id, &inicio, &tam, &busqueda)) {
+        if (r->histograma) histogramar(r->notas + inicio, tam, &h);
+        else clasificar(r->notas + inicio, tam, &c);
+        cantidad += tam;
+        bloques++;
+    }
+    if (r->contadores) contadores_detener(&cnt, &res->hw);
+    if (r->histograma) histograma_conteo(&h, &c);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    long en_rango = r->histograma ? cantidad - h.fuera : cantidad;   // La suma del histograma no incluye las fuera de rango
+    res->promedio = en_rango ? (double)c.suma / en_rango : 0;
+    res->hist     = h;
+    res->c        = c;
+    res->cantidad = cantidad;
+    res->tiempo   = segundos_entre(t0, t1);
+    res->bloques  = bloques;
+    res->busqueda = busqueda;
+    res->fin      = t1;
+    res->cpu      = sched_getcpu();
+    return NULL;
+}
+
+/*
+ * Trabajo del proceso p: lanza sus hilos y, cuando terminan, hace el segundo
+ * nivel de la reducción (suma a sus hilos en memoria privada del proceso) y el
+ * tercero (deja esa suma en su ranura del agregador global).
+ */
+static void trabajar_proceso(const recursos *r, int p)
+{
+    int primero = primer_hilo(r, p), n = primer_hilo(r, p + 1) - primero;
+    pthread_t *hilos = malloc(sizeof(pthread_t) * n);
+    dato_hilo *datos = malloc(sizeof(dato_hilo) * n);
+    if (!hilos || !datos) { perror("malloc"); _exit(EXIT_FAILURE); }
+    long fallos0 = fallos_menores(RUSAGE_SELF);
+    for (int t = 0; t < n; ++t) {
+        datos[t] = (dato_hilo){ .id = primero + t, .r = r };
+        if (pthread_create(&hilos[t], NULL, procesar, &datos[t]) != 0) {
+            perror("pthread_create");
+            _exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < n; ++t)
+        pthread_join(hilos[t], NULL);
+
+    // Reducción local: solo los hilos de este proceso, sin tocar memoria de los demás
+    resultado_proceso *res = &r->procesos[p];
+    conteo c = {0};
+    histograma h = {0};
+    long cantidad = 0;
+    struct timespec ultimo = r->hilos[primero].fin, t1;
+    for (int i = primero; i < primero + n; ++i) {
+        const resultado_hilo *rh = &r->hilos[i];
+        c.suma          += rh->c.suma;
+        c.reprobados    += rh->c.reprobados;
+        c.aprobado_bajo += rh->c.aprobado_bajo;
+        c.aprobado_alto += rh->c.aprobado_alto;
+        c.fuera         += rh->c.fuera;
+        if (r->histograma) histograma_sumar(&h, &rh->hist);
+        cantidad += rh->cantidad;
+        if (segundos_entre(ultimo, rh->fin) > 0) ultimo = rh->fin;
+    }
+    // Reducción global: una suma por proceso en el agregador compartido
+    agregador_sumar(r->totales, p, &c);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    res->hist      = h;
+    res->c         = c;
+    res->cantidad  = cantidad;
+    res->reduccion = segundos_entre(ultimo, t1);
+    res->espera    = r->totales->ranuras[p].espera;
+    res->fallos    = fallos_menores(RUSAGE_SELF) - fallos0;
+    free(hilos);
+    free(datos);
+}
+
+/*
+ * Crea los P procesos con fork() (cada uno lanza sus hilos) y espera a que terminen.
+ * t0, t1: marcas de inicio y fin del procesamiento (cómputo y reducción, sin la generación).
+ * tiempo_inicio: hora del sistema al comenzar el procesamiento.
+ * f: duración de cada fase salvo el reporte, que mide quien imprime.
+ * Retorna 0, o -1 si algún proceso no se pudo crear o terminó mal (ya reportado;
+ * los demás quedan muertos y recogidos).
+ */
+static int ejecutar_hibrido(const recursos *r, hijos *h, struct timespec *t0, struct timespec *t1,
+                            time_t *tiempo_inicio, fases *f)
+{
+    struct timespec tg0, tl1;
+    clock_gettime(CLOCK_MONOTONIC, &tg0); // Inicio del lanzamiento (y de la generación)
+    for (int p = 0; p < r->n_procesos; ++p) {
+        pid_t pid = fork();
+        if (pid < 0) { perror("fork"); hijos_matar(h); return -1; }
+        if (pid == 0) {
+            trabajar_proceso(r, p);
+            _exit(0);
+        }
+        hijos_agregar(h, pid);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tl1); // Fin del lanzamiento
+
+    // La marca se toma entre las dos esperas para que ningún hilo procese antes de ella.
+    // El padre entra a la barrera recién cuando llegaron todos los hilos: un proceso que
+    // falla antes (sin memoria o sin poder crear sus hilos) no lo deja esperando ahí
+    if (hijos_esperar_llegadas(h, &r->inicio->llegados, r->n_hilos) != 0) return -1;
+    pthread_barrier_wait(&r->inicio->barrera);
+    clock_gettime(CLOCK_MONOTONIC, t0);
+    *tiempo_inicio = time(NULL);
+    pthread_barrier_wait(&r->inicio->barrera);
+
+    // Espera a que terminen los procesos (y con ellos sus hilos); si alguno falla, la corrida no vale
+    if (hijos_esperar(h) != 0) return -1;
+    clock_gettime(CLOCK_MONOTONIC, t1);
+
+    // Inactividad: lo que cada hilo esperó al último en terminar (CLOCK_MONOTONIC es común a todos)
+    resultado_hilo *res = r->hilos;
+    struct timespec ultimo = res[0].fin;
+    for (int i = 1; i < r->n_hilos; ++i)
+        if (segundos_entre(ultimo, res[i].fin) > 0) ultimo = res[i].fin;
+    for (int i = 0; i < r->n_hilos; ++i)
+        res[i].inactivo = segundos_entre(res[i].fin, ultimo) + res[i].busqueda;
+
+    f->lanzamiento = segundos_entre(tg0, tl1);
+    f->generacion  = segundos_entre(tl1, *t0);
+    f->computo     = segundos_entre(*t0, ultimo);
+    f->reduccion   = segundos_entre(ultimo, *t1);
+    f->reporte     = 0;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    opciones op;
+    parsear_opciones(argc, argv, &op);
+    if (op.servir || op.barrido || op.agrupar || op.instantanea || op.tuberia || op.ventana_mib
+        || op.shm || op.trabajador >= 0) {
+        fprintf(stderr, "El motor híbrido no admite --servir, --barrido, --agrupar, --instantanea, "
+                        "--tuberia, --ventana, --shm ni --trabajador\n");
+        return EXIT_FAILURE;
+    }
+    if (op.exportar) {
+        // Solo escribe el conjunto de datos generado y termina
+        if (archivo_exportar(op.exportar, op.total, op.semilla, op.secciones) != 0) { perror(op.exportar); return EXIT_FAILURE; }
+        printf("Exportadas %ld notas a %s (semilla %llu)\n", op.total, op.exportar, (unsigned long long)op.semilla);
+        if (op.secciones) printf("Con una clave por nota entre 0 y %u\n", op.secciones - 1);
+        return EXIT_SUCCESS;
+    }
+    const char *kernel = seleccionar_kernel(op.kernel); // Los hijos heredan la selección
+    if (!kernel) { fprintf(stderr, "Kernel no disponible: %s\n", op.kernel); return EXIT_FAILURE; }
+    static afinidad afin;   // Topología y CPUs para cada hilo
+    if (afinidad_preparar(&afin, op.afinidad) != 0) { fprintf(stderr, "Afinidad inválida: %s\n", op.afinidad); return EXIT_FAILURE; }
+
+    // P × T: --trabajadores hilos en total entre --procesos procesos (por defecto, uno por nodo NUMA)
+    int n_hilos = op.trabajadores;
+    int n_procesos = op.procesos ? op.procesos : afin.topo.n_nodos;
+    if (n_procesos < 1) n_procesos = 1;
+    if (n_procesos > n_hilos) {
+        if (op.procesos) {
+            fprintf(stderr, "--procesos (%d) no puede superar a --trabajadores (%d)\n", n_procesos, n_hilos);
+            return EXIT_FAILURE;
+        }
+        n_procesos = n_hilos;
+    }
+
+    recursos r = { .n_procesos = n_procesos, .n_hilos = n_hilos, .semilla = op.semilla, .generar = 1,
+                   .histograma = op.histograma, .contadores = op.contadores, .afin = &afin, .total = op.total };
+    archivo_notas archivo;
+    const char *origen_datos = "mmap anónimo heredado con fork()";
+    char origen_archivo[4200];
+    if (op.archivo) {
+        // El archivo mapeado completo lo heredan los procesos con fork()
+        if (archivo_abrir(&archivo, op.archivo, 1) != 0) return EXIT_FAILURE;
+        r.total = archivo.cantidad;
+        r.notas = archivo.notas;
+        r.generar = 0;
+        snprintf(origen_archivo, sizeof(origen_archivo), "archivo %s (mapeado completo)", op.archivo);
+        origen_datos = origen_archivo;
+    } else {
+        // Cada hilo genera su tramo: con afinidad, cada página queda en el nodo de quien la toca primero
+        r.notas = compartida(sizeof(nota_t) * r.total);
+        if (!r.notas) { perror("mmap"); return EXIT_FAILURE; }
+    }
+
+    // Resultados, agregador, planificador y barrera en memoria compartida
+    long tam_bloque = op.bloque_kib * 1024 / (long)sizeof(nota_t);
+    if (planificador_admite(r.total, tam_bloque) != 0) {
+        fprintf(stderr, "Demasiados bloques: %ld notas en bloques de %ld (máximo %u); use bloques mayores\n",
+                r.total, tam_bloque, UINT32_MAX);
+        return EXIT_FAILURE;
+    }
+    modo_reparto modo = op.estatico ? REPARTO_ESTATICO : REPARTO_ROBO;
+    size_t bytes_hilos = sizeof(resultado_hilo) * n_hilos, bytes_procesos = sizeof(resultado_proceso) * n_procesos;
+    size_t bytes_agregador = agregador_tamano(n_procesos), bytes_plan = planificador_tamano(n_hilos);
+    r.hilos = compartida(bytes_hilos);
+    r.procesos = compartida(bytes_procesos);
+    r.totales = compartida(bytes_agregador);
+    r.plan = compartida(bytes_plan);
+    r.inicio = compartida(sizeof(arranque));
+    if (!r.hilos || !r.procesos || !r.totales || !r.plan || !r.inicio) { perror("mmap"); return EXIT_FAILURE; }
+    agregador_iniciar(r.totales, op.agregacion, n_procesos, 1);
+    // Con robo de trabajo cada hilo busca primero en las colas de sus vecinos, que son de su proceso
+    planificador_iniciar(r.plan, modo, n_hilos, r.total, tam_bloque);
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&r.inicio->barrera, &attr, n_hilos + 1);
+    pthread_barrierattr_destroy(&attr);
+
+    struct timespec t0, t1;
+    time_t tiempo_inicio;
+    fases f;
+    long fallos_antes = fallos_menores(RUSAGE_CHILDREN);
+    hijos h;
+    if (hijos_iniciar(&h, n_procesos) != 0) { perror("malloc"); return EXIT_FAILURE; }
+    // Si un proceso falló o el archivo trae notas fuera de rango no se reporta ni se registra nada
+    if (ejecutar_hibrido(&r, &h, &t0, &t1, &tiempo_inicio, &f) != 0) return EXIT_FAILURE;
+    hijos_liberar(&h);
+    long long fuera = 0;
+    for (int p = 0; p < n_procesos; ++p) fuera += r.procesos[p].c.fuera;
+    if (archivo_fuera_de_rango(op.archivo, fuera) != 0) return EXIT_FAILURE;
+    long fallos_hijos = fallos_menores(RUSAGE_CHILDREN) - fallos_antes;
+    double duracion_total = segundos_entre(t0, t1);
+    time_t tiempo_fin = time(NULL);
+
+    // Histograma global: tercer nivel sobre los histogramas ya reducidos por proceso
+    histograma hist = {0};
+    if (op.histograma)
+        for (int p = 0; p < n_procesos; ++p) histograma_sumar(&hist, &r.procesos[p].hist);
+    long long resumen_global[3];
+    agregador_totales(r.totales, resumen_global);
+
+    const resultado_hilo *res = r.hilos;
+    registro_grupo *grupos = malloc(sizeof(registro_grupo) * n_hilos);
+    medicion_hw *mediciones = malloc(sizeof(medicion_hw) * n_hilos);
+    if (!grupos || !mediciones) { perror("malloc"); return EXIT_FAILURE; }
+    printf("\n=== HÍBRIDO (%d proceso(s), %d hilo(s) en total) ===\n", n_procesos, n_hilos);
+    for (int i = 0; i < n_hilos; ++i) {
+        // Los hilos no tocan el agregador global: su espera es la de su proceso
+        mediciones[i] = res[i].hw;
+        grupos[i] = (registro_grupo){ .promedio = res[i].promedio, .reprobados = res[i].c.reprobados,
+                                      .aprobado_bajo = res[i].c.aprobado_bajo, .aprobado_alto = res[i].c.aprobado_alto,
+                                      .cantidad = res[i].cantidad, .tiempo = res[i].tiempo, .espera = 0,
+                                      .bloques = res[i].bloques, .inactivo = res[i].inactivo, .cpu = res[i].cpu,
+                                      .hw = op.contadores ? &mediciones[i] : NULL };
+        etiqueta_grupo(i, grupos[i].etiqueta);
+        registro_imprimir_grupo(stdout, &grupos[i]);
+    }
+    printf("\n=== Reducción por proceso ===\n");
+    for (int p = 0; p < n_procesos; ++p) {
+        const resultado_proceso *rp = &r.procesos[p];
+        char desde[ETIQUETA_MAX], hasta[ETIQUETA_MAX];
+        long en_rango = rp->cantidad - rp->hist.fuera;   // hist.fuera es 0 sin --histograma
+        etiqueta_grupo(primer_hilo(&r, p), desde);
+        etiqueta_grupo(primer_hilo(&r, p + 1) - 1, hasta);
+        printf("Proceso %d | Hilos: %s-%s | Promedio: %.2f | Notas: %ld | Reducción local: %.3f us | "
+               "Espera agregación: %.3f us | Fallos de página: %ld\n",
+               p, desde, hasta, en_rango ? (double)rp->c.suma / en_rango : 0, rp->cantidad,
+               1e6 * rp->reduccion, 1e6 * rp->espera, rp->fallos);
+    }
+
+    printf("\n=== Totales Globales (%s) ===\n", agregacion_nombre(r.totales->modo));
+    printf("Reprobados: %lld\n", resumen_global[0]);
+    printf("Aprobados (18-27.99): %lld\n", resumen_global[1]);
+    printf("Aprobados (28-40): %lld\n", resumen_global[2]);
+    agregador_imprimir_esperas(r.totales);
+    if (op.histograma) histograma_imprimir(&hist, op.cortes, op.n_cortes);
+
+    printf("\n=== Resumen (HÍBRIDO) ===\n");
+    char buf_inicio[64], buf_fin[64];
+    strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&tiempo_inicio));
+    strftime(buf_fin, sizeof(buf_fin), "%a %b %d %H:%M:%S", localtime(&tiempo_fin));
+    printf("Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&tiempo_inicio)->tm_year);
+    printf("Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&tiempo_fin)->tm_year);
+    printf("Duración total: %.6f segundos\n", duracion_total);
+    printf("Ancho de banda: %.2f GB/s (kernel %s, %zu byte(s) por nota)\n",
+           gbps(r.total, duracion_total), kernel, sizeof(nota_t));
+    if (r.generar)
+        printf("Generación: %.6f segundos (semilla %llu)\n", f.generacion, (unsigned long long)op.semilla);
+    printf("Reparto: %s, %ld bloques de %ld KiB\n", reparto_nombre(modo), r.plan->n_bloques,
+           tam_bloque * (long)sizeof(nota_t) / 1024);
+
+    // Ancho de banda por nodo NUMA según la CPU donde terminó cada hilo
+    int *cpus = malloc(sizeof(int) * n_hilos);
+    long *cantidades = malloc(sizeof(long) * n_hilos);
+    double *tiempos = malloc(sizeof(double) * n_hilos);
+    if (!cpus || !cantidades || !tiempos) { perror("malloc"); return EXIT_FAILURE; }
+    for (int i = 0; i < n_hilos; ++i) {
+        cpus[i] = res[i].cpu;
+        cantidades[i] = res[i].cantidad;
+        tiempos[i] = res[i].tiempo;
+    }
+    afinidad_imprimir_nodos(&afin, cpus, cantidades, tiempos, n_hilos);
+    if (op.contadores) contadores_imprimir(mediciones, cantidades, n_hilos);
+    free(cpus);
+    free(cantidades);
+    free(tiempos);
+
+    printf("\n=== Costos de lanzamiento (HÍBRIDO) ===\n");
+    printf("Datos: %s\n", origen_datos);
+    printf("Lanzamiento (fork de %d procesos): %.6f segundos\n", n_procesos, f.lanzamiento);
+    printf("Fallos de página menores de los hijos: %ld\n", fallos_hijos);
+
+    // El reporte va desde el fin de la reducción hasta aquí
+    struct timespec t_reporte;
+    clock_gettime(CLOCK_MONOTONIC, &t_reporte);
+    f.reporte = segundos_entre(t1, t_reporte);
+    printf("\n");
+    imprimir_fases(&f);
+
+    if (op.historial) {
+        registro_corrida reg = { .motor = "hibrido", .kernel = kernel, .agregacion = agregacion_nombre(r.totales->modo),
+                                 .reparto = reparto_nombre(modo), .afinidad = op.afinidad,
+                                 .datos = op.archivo ? op.archivo : "generadas", .semilla = op.semilla,
+                                 .trabajadores = n_hilos, .procesos = n_procesos, .total = r.total,
+                                 .bloque_kib = tam_bloque * (long)sizeof(nota_t) / 1024,
+                                 .inicio = tiempo_inicio, .duracion = duracion_total, .f = f,
+                                 .totales = { resumen_global[0], resumen_global[1], resumen_global[2] },
+                                 .hist = op.histograma ? &hist : NULL,
+                                 .n_grupos = n_hilos, .grupos = grupos };
+        if (registro_agregar(op.historial, &reg) != 0) perror(op.historial);
+    }
+    free(grupos);
+    free(mediciones);
+
+    pthread_barrier_destroy(&r.inicio->barrera);
+    agregador_destruir(r.totales);
+    munmap(r.inicio, sizeof(arranque));
+    munmap(r.plan, bytes_plan);
+    munmap(r.totales, bytes_agregador);
+    munmap(r.procesos, bytes_procesos);
+    munmap(r.hilos, bytes_hilos);
+    if (op.archivo) archivo_cerrar(&archivo);
+    else munmap(r.notas, sizeof(nota_t) * r.total);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include "hijos.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#define SONDEO_NS 50000   // Pausa entre sondeos mientras los hijos llegan a la barrera (50 us)
+
+int hijos_iniciar(hijos *h, int capacidad)
+{
+    h->pids = calloc((size_t)capacidad, sizeof(pid_t));
+    h->n = 0;
+    return h->pids ? 0 : -1;
+}
+
+void hijos_agregar(hijos *h, pid_t pid)
+{
+    h->pids[h->n++] = pid;
+}
+
+/* Da por recogido al hijo pid; retorna 0 si terminó con estado 0 y, si no, lo reporta */
+static int recogido(hijos *h, pid_t pid, int estado)
+{
+    int i = 0;
+    while (i < h->n && h->pids[i] != pid) ++i;
+    if (i < h->n) h->pids[i] = 0;
+    if (WIFEXITED(estado) && WEXITSTATUS(estado) == 0) return 0;
+    if (WIFSIGNALED(estado))
+        fprintf(stderr, "El hijo %d (PID %d) terminó por la señal %d\n", i, (int)pid, WTERMSIG(estado));
+    else
+        fprintf(stderr, "El hijo %d (PID %d) terminó con estado %d\n", i, (int)pid, WEXITSTATUS(estado));
+    return -1;
+}
+
+int hijos_vivos(const hijos *h)
+{
+    int vivos = 0;
+    for (int i = 0; i < h->n; ++i) vivos += h->pids[i] > 0;
+    return vivos;
+}
+
+void hijos_matar(hijos *h)
+{
+    for (int i = 0; i < h->n; ++i)
+        if (h->pids[i] > 0) kill(h->pids[i], SIGKILL);
+    for (int i = 0; i < h->n; ++i) {
+        if (h->pids[i] <= 0) continue;
+        while (waitpid(h->pids[i], NULL, 0) < 0 && errno == EINTR);
+        h->pids[i] = 0;
+    }
+}
+
+int hijos_esperar_llegadas(hijos *h, _Atomic int *llegados, int esperados)
+{
+    const struct timespec pausa = { 0, SONDEO_NS };
+    while (atomic_load_explicit(llegados, memory_order_acquire) < esperados) {
+        int estado;
+        pid_t pid = waitpid(-1, &estado, WNOHANG);
+        if (pid > 0) {
+            if (recogido(h, pid, estado) == 0)
+                fprintf(stderr, "El hijo PID %d terminó antes de llegar a la barrera\n", (int)pid);
+            hijos_matar(h);
+            return -1;
+        }
+        nanosleep(&pausa, NULL);
+    }
+    return 0;
+}
+
+int hijos_esperar(hijos *h)
+{
+    for (int vivos = hijos_vivos(h); vivos > 0; ) {
+        int estado;
+        pid_t pid = waitpid(-1, &estado, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            perror("waitpid");
+            hijos_matar(h);
+            return -1;
+        }
+        vivos--;
+        if (recogido(h, pid, estado) != 0) {
+            hijos_matar(h);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void hijos_liberar(hijos *h)
+{
+    free(h->pids);
+    h->pids = NULL;
+    h->n = 0;
+}
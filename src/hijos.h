@@ -0,0 +1,48 @@
+#ifndef HIJOS_H
+#define HIJOS_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+
+/*
+ * Procesos hijos de una corrida. Un hijo que termina antes de tiempo no debe
+ * dejar a los demás ni al padre esperando en una barrera compartida a alguien
+ * que ya no va a llegar: el padre espera una barrera recién cuando todos
+ * llegaron a ella y, si alguno termina mal, mata al resto.
+ */
+typedef struct {
+    pid_t *pids;          // PID de cada hijo en orden de lanzamiento (0 si ya se recogió)
+    int n;                // Hijos lanzados en la corrida actual (0 para empezar otra)
+} hijos;
+
+/* Reserva lugar para capacidad hijos; retorna 0 o -1 */
+int hijos_iniciar(hijos *h, int capacidad);
+
+/* Anota un hijo recién lanzado */
+void hijos_agregar(hijos *h, pid_t pid);
+
+/*
+ * Antes de que el padre espere una barrera con los hijos: espera a que
+ * *llegados (que cada hijo o hilo incrementa justo antes de esperarla) llegue
+ * a esperados, sondeando mientras tanto con waitpid(WNOHANG). Retorna 0, o -1
+ * si algún hijo terminó antes (con los demás ya muertos y recogidos).
+ */
+int hijos_esperar_llegadas(hijos *h, _Atomic int *llegados, int esperados);
+
+/*
+ * Espera a que terminen todos los hijos con waitpid(). Si alguno termina con
+ * un estado distinto de cero o por una señal, lo reporta y mata al resto (que
+ * podría estar esperando en una barrera solo entre hijos). Retorna 0 si todos
+ * terminaron bien o -1 si no.
+ */
+int hijos_esperar(hijos *h);
+
+/* Hijos lanzados que todavía no se recogieron */
+int hijos_vivos(const hijos *h);
+
+/* Mata con SIGKILL a los hijos que siguen vivos y los recoge */
+void hijos_matar(hijos *h);
+
+void hijos_liberar(hijos *h);
+
+#endif
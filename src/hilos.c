@@ -1,138 +1,464 @@
+#define _GNU_SOURCE   /* sched_getcpu */
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
 #include <unistd.h>   /* sysconf */
 #include <string.h>
+#include <fcntl.h>
 
-#define TOTAL_NOTAS 20000000   // Total de notas a procesar
-#define MAX_NOTA    40         // Nota máxima posible
+#include "comun.h"
+#include "afinidad.h"
+#include "agregacion.h"
+#include "agrupacion.h"
+#include "archivo.h"
+#include "barrido.h"
+#include "clasificacion.h"
+#include "contadores.h"
+#include "generador.h"
+#include "histograma.h"
+#include "instantanea.h"
+#include "opciones.h"
+#include "planificador.h"
+#include "registro.h"
+#include "servidor.h"
+#include "tuberia.h"
 
-/* Resultado individual de cada hilo */
+/* Resultado individual de cada hilo (cada uno en su línea de caché para no compartirla) */
 typedef struct {
-    double promedio;      // Promedio de notas del grupo
-    int reprobados;       // Cantidad de reprobados (<18)
-    int aprobado_bajo;    // Cantidad de aprobados bajos (18-27.99)
-    int aprobado_alto;    // Cantidad de aprobados altos (28-40)
+    _Alignas(LINEA_CACHE) double promedio; // Promedio de notas del grupo
+    long long suma;          // Suma de las notas procesadas (para el promedio de una consulta)
+    histograma hist;         // Histograma de lo procesado (--histograma)
+    particiones_grupos locales; // Tablas por clave de lo procesado, una por partición (--agrupar)
+    resumen_grupos grupos;   // Resumen de la partición que mezcló este hilo
+    size_t bytes_salida;     // Bytes de su partición en --salida-grupos
+    long long reprobados;    // Cantidad de reprobados (<18)
+    long long aprobado_bajo; // Cantidad de aprobados bajos (18-27.99)
+    long long aprobado_alto; // Cantidad de aprobados altos (28-40)
+    long long fuera;         // Notas fuera de [0, MAX_NOTA] (un archivo ajeno: la corrida se rechaza)
+    long cantidad;        // Notas procesadas por el hilo
     double tiempo;        // Tiempo de ejecución del hilo en segundos
+    double espera;        // Tiempo en la agregación de totales globales
+    int bloques;          // Bloques procesados (propios y robados)
+    double busqueda;      // Tiempo buscando bloques que robar
+    struct timespec fin;  // Momento en que terminó su último bloque
+    double inactivo;      // Tiempo sin trabajo: esperando al último hilo o buscando bloques
+    int cpu;              // CPU en la que terminó (para el ancho de banda por nodo)
+    medicion_hw hw;       // Contadores de su bucle (--contadores)
 } resultado_hilo;
 
+typedef struct grupo_hilos grupo_hilos;
+
 /* Datos pasados al hilo */
 typedef struct {
     int id;               // Identificador del hilo (0..n-1)
-    int *notas;           // Puntero al arreglo global de notas
-    long inicio;          // Índice inicial de notas a procesar
-    long cantidad;        // Cuántas notas procesa este hilo
+    nota_t *notas;        // Puntero al arreglo global de notas
+    clave_t *claves;      // Clave de cada nota (--agrupar; NULL si no se agrupa)
+    uint32_t secciones;   // Claves distintas al generarlas o rango de las del archivo
+    const archivo_notas *ventanas; // Con --ventana: cada bloque se mapea al procesarlo (NULL si no)
+    planificador *plan;   // Reparte los bloques de notas entre los hilos
+    const afinidad *afin; // Política para fijar el hilo a una CPU
+    uint64_t semilla;     // Semilla con la que genera su bloque
+    int generar;          // 1: genera su bloque antes de procesarlo
+    int histograma;       // 1: arma el histograma de notas en lugar de solo clasificar
+    long desde;           // Primera nota a procesar (con --instantanea, la primera agregada)
+    int contadores;       // 1: mide su bucle con perf_event_open y getrusage
+    pthread_barrier_t *barrera; // Separa la generación del procesamiento
+    pthread_barrier_t *mezcla;  // Entre la agregación local y la mezcla por particiones (--agrupar)
+    int salida;           // Descriptor de --salida-grupos (-1 si no hay)
+    agregador *totales;   // Totales globales compartidos por todos los hilos
     resultado_hilo *resultado;  // Puntero a su celda resultado
+    resultado_hilo *todos;      // Resultados de todos los hilos (para mezclar las particiones)
+    tuberia *tuberia;     // Con --tuberia: de donde toma los trozos (NULL si no)
+    grupo_hilos *grupo;   // Grupo persistente que atiende consultas (--servir)
 } dato_hilo;
 
-// Arreglo global compartido para totales: [reprobados, aprobado_bajo, aprobado_alto]
-int resumen_global[3] = {0, 0, 0};
-pthread_mutex_t resumen_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Recursos compartidos por todas las corridas de hilos */
+typedef struct {
+    nota_t *notas;                 // Notas en memoria (generadas o mapeadas del archivo)
+    clave_t *claves;               // Clave de cada nota (--agrupar; NULL si no se agrupa)
+    uint32_t secciones;            // Claves distintas al generarlas o rango de las del archivo (corta las particiones)
+    int salida;                    // Descriptor de --salida-grupos (-1 si no hay)
+    const archivo_notas *ventanas; // Archivo leído por ventanas (NULL si las notas están en memoria)
+    planificador *plan;            // Reparte los bloques entre los hilos (ya iniciado)
+    const afinidad *afin;          // Política de afinidad que aplica cada hilo al comenzar
+    agregador *totales;            // Totales globales
+    resultado_hilo *res;           // Un resultado por hilo
+    int histograma;                // 1: cada hilo arma el histograma de sus notas
+    long desde;                    // Primera nota a procesar: el planificador reparte [desde, total)
+    int contadores;                // 1: cada hilo mide su bucle con perf_event_open y getrusage
+} recursos;
+
+/*
+ * Grupo de hilos que sigue vivo entre consultas (--servir): se crean y generan
+ * las notas una sola vez y cada consulta solo cuesta dos esperas en barrera.
+ */
+struct grupo_hilos {
+    const recursos *r;
+    int n_hilos;
+    modo_reparto modo;          // Reparto de los bloques de cada consulta
+    long tam_bloque;            // Notas por bloque
+    modo_agregacion agregacion; // Totales de cada consulta
+    pthread_t *hilos;
+    dato_hilo *datos;
+    pthread_barrier_t inicio;   // El hilo principal publicó una consulta (o la salida)
+    pthread_barrier_t fin;      // Todos los hilos terminaron la consulta
+    long desde;                 // Primera nota de la consulta en curso
+    int salir;                  // 1: los hilos terminan en el próximo inicio
+};
+
+/*
+ * Procesa los bloques que el planificador le entrega al hilo, desplazados desde
+ * notas (el comienzo del rango pedido), y los acumula en c o, si h no es NULL,
+ * en el histograma h (de donde luego sale c sin otra pasada). Si p no es NULL
+ * además agrupa cada nota por su clave en las tablas locales p.
+ * Retorna la cantidad de notas procesadas.
+ */
+static long recorrer(const dato_hilo *info, long desde, conteo *c, histograma *h, particiones_grupos *p,
+                     int *bloques, double *busqueda)
+{
+    long inicio, tam, cantidad = 0;
+    while (planificador_siguiente(info->plan, info->id, &inicio, &tam, busqueda)) {
+        inicio += desde;
+        // En modo ventana solo está mapeado el bloque en curso
+        ventana v = {0};
+        const nota_t *datos = info->ventanas ? archivo_ventana(info->ventanas, inicio, tam, &v) : info->notas + inicio;
+        if (!datos) { perror("mmap"); exit(EXIT_FAILURE); }
+        if (p) agrupar(datos, info->claves + inicio, tam, p);
+        if (h) histogramar(datos, tam, h);
+        else if (!p) clasificar(datos, tam, c);
+        ventana_liberar(&v);
+        cantidad += tam;
+        (*bloques)++;
+    }
+    return cantidad;
+}
+
+/*
+ * Mezcla por particiones (--agrupar): cuando todos los hilos terminaron su
+ * agregación local, el hilo p suma la partición p de las tablas de todos (ninguna
+ * clave está en dos particiones, así que no hace falta bloquear nada), la ordena
+ * por clave y escribe sus filas en su lugar de --salida-grupos.
+ */
+static void mezclar_particion(const dato_hilo *info)
+{
+    int n = info->plan->n, p = info->id;
+    resultado_hilo *todos = info->todos, *propio = info->resultado;
+    pthread_barrier_wait(info->mezcla); // Todas las tablas locales listas
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long filas = 0, mayor = 0;
+    for (int t = 0; t < n; ++t) {
+        filas += todos[t].locales.tablas[p].usadas;
+        if (todos[t].locales.tablas[p].usadas > mayor) mayor = todos[t].locales.tablas[p].usadas;
+    }
+    // La partición tiene al menos tantas claves como la mayor tabla local (la suma las sobrestima n veces)
+    tabla_grupos final = {0};
+    if (tabla_reservar(&final, mayor) != 0) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int t = 0; t < n; ++t)
+        tabla_mezclar(&final, todos[t].locales.tablas[p].filas, todos[t].locales.tablas[p].capacidad);
+    long claves = tabla_ordenar(&final);
+    grupos_resumir(final.filas, claves, &propio->grupos);
+    propio->grupos.filas_locales = filas;
+    propio->grupos.descartadas = propio->locales.descartadas;
+    char *texto = NULL;
+    size_t bytes = 0;
+    if (info->salida >= 0 && !(texto = grupos_csv(final.filas, claves, &bytes))) { perror("malloc"); exit(EXIT_FAILURE); }
+    propio->bytes_salida = bytes;
+    pthread_barrier_wait(info->mezcla); // Todas las particiones mezcladas y con su tamaño en la salida
+
+    particiones_liberar(&propio->locales);
+    if (texto) {
+        // Cada partición va a continuación de las anteriores: todos escriben a la vez
+        off_t desde = (off_t)strlen(GRUPOS_CABECERA_CSV);
+        for (int t = 0; t < p; ++t) desde += (off_t)todos[t].bytes_salida;
+        if (grupos_escribir(info->salida, texto, bytes, desde) != 0) perror("--salida-grupos");
+        free(texto);
+    }
+    tabla_liberar(&final);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    propio->grupos.local  = propio->tiempo;
+    propio->grupos.mezcla = segundos_entre(t0, t1);
+}
+
+/*
+ * Deja en la celda del hilo lo que procesó (cantidad notas en bloques bloques,
+ * con los conteos c, entre t0 y t1) y lo suma a los totales globales.
+ */
+static void publicar(dato_hilo *info, const conteo *c, long cantidad, int bloques, double busqueda,
+                     struct timespec t0, struct timespec t1)
+{
+    // Con histograma la suma no incluye las notas fuera de rango: tampoco el divisor
+    long en_rango = info->histograma ? cantidad - info->resultado->hist.fuera : cantidad;
+    info->resultado->promedio       = en_rango ? (double)c->suma / en_rango : 0;
+    info->resultado->suma           = c->suma;
+    info->resultado->reprobados     = c->reprobados;
+    info->resultado->aprobado_bajo  = c->aprobado_bajo;
+    info->resultado->aprobado_alto  = c->aprobado_alto;
+    info->resultado->fuera          = c->fuera;
+    info->resultado->cantidad       = cantidad;
+    info->resultado->tiempo = segundos_entre(t0, t1);
+    info->resultado->bloques  = bloques;
+    info->resultado->busqueda = busqueda;
+    info->resultado->fin      = t1;
+    info->resultado->cpu      = sched_getcpu();
+    // Actualiza los totales globales (con mutex, atómicos o en su ranura)
+    agregador_sumar(info->totales, info->id, c);
+    info->resultado->espera = info->totales->ranuras[info->id].espera;
+}
 
 /*
  * Función que ejecuta cada hilo.
  * arg: puntero a dato_hilo con los datos de trabajo y resultado.
- * Calcula el promedio y clasificaciones, mide su tiempo y actualiza los totales globales.
+ * Se fija a su CPU (si hay política de afinidad) antes de tocar las notas, así
+ * las páginas del tramo que genera quedan en su nodo NUMA. Luego espera en la barrera a que
+ * todos terminen de generar y luego procesa bloques de su cola hasta vaciarla,
+ * robando a otros hilos cuando se queda sin trabajo. Calcula el promedio y
+ * clasificaciones de lo que procesó, mide su tiempo y actualiza los totales globales.
  */
 static void *procesar(void *arg)
 {
     dato_hilo *info = (dato_hilo *)arg; // Conversión de void* a dato_hilo*
+    afinidad_fijar(info->afin, info->id);
+    if (info->generar) {
+        long inicio, cantidad;
+        planificador_tramo(info->plan, info->id, &inicio, &cantidad);
+        inicio += info->desde;
+        generar_notas(info->notas, inicio, cantidad, info->semilla);
+        if (info->claves) generar_claves_en(info->claves + inicio, inicio, cantidad, info->semilla, info->secciones);
+    }
+    pthread_barrier_wait(info->barrera); // Todos los bloques listos antes de medir
+    pthread_barrier_wait(info->barrera); // El hilo principal ya marcó el inicio
+
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0); // Marca de tiempo inicial del hilo
-    long suma = 0;
-    int rep = 0, ab = 0, aa = 0;
-    // Procesa su bloque de notas
-    for (long i = info->inicio; i < info->inicio + info->cantidad; ++i) {
-        int n = info->notas[i];
-        suma += n;
-        if (n < 18) rep++;
-        else if (n < 28) ab++;
-        else aa++;
-    }
+    // Procesa bloque a bloque con el kernel elegido al inicio
+    conteo c = {0};
+    int bloques = 0;
+    double busqueda = 0;
+    histograma *h = info->histograma ? &info->resultado->hist : NULL;
+    if (h) memset(h, 0, sizeof(*h));
+    particiones_grupos *p = info->claves ? &info->resultado->locales : NULL;
+    if (p && particiones_iniciar(p, info->plan->n, info->secciones) != 0) { perror("malloc"); exit(EXIT_FAILURE); }
+    contadores cnt;
+    if (info->contadores) contadores_iniciar(&cnt);
+    long cantidad = recorrer(info, info->desde, &c, h, p, &bloques, &busqueda);
+    if (info->contadores) contadores_detener(&cnt, &info->resultado->hw);
+    if (h) histograma_conteo(h, &c);
+    else if (p) particiones_conteo(p, &c);
     clock_gettime(CLOCK_MONOTONIC, &t1); // Marca de tiempo final del hilo
-    info->resultado->promedio       = (double)suma / info->cantidad;
-    info->resultado->reprobados     = rep;
-    info->resultado->aprobado_bajo  = ab;
-    info->resultado->aprobado_alto  = aa;
-    info->resultado->tiempo = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
-    // Sección crítica: actualiza los totales globales
-    pthread_mutex_lock(&resumen_mutex);
-    resumen_global[0] += rep;
-    resumen_global[1] += ab;
-    resumen_global[2] += aa;
-    pthread_mutex_unlock(&resumen_mutex);
+    publicar(info, &c, cantidad, bloques, busqueda, t0, t1);
+    if (p) mezclar_particion(info);
+    return NULL;
+}
+
+/*
+ * Consumidor de la tubería (--tuberia): toma trozos llenos hasta que los
+ * productores terminan y los procesa igual que procesar() procesa sus bloques.
+ * Lo que espera a la cola cuenta como búsqueda (parte de su inactividad).
+ */
+static void *consumir(void *arg)
+{
+    dato_hilo *info = (dato_hilo *)arg;
+    afinidad_fijar(info->afin, info->id);
+    pthread_barrier_wait(info->barrera); // Todos los hilos creados
+    pthread_barrier_wait(info->barrera); // El hilo principal ya marcó el inicio
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    conteo c = {0};
+    int bloques = 0;
+    long cantidad = 0;
+    histograma *h = info->histograma ? &info->resultado->hist : NULL;
+    if (h) memset(h, 0, sizeof(*h));
+    contadores cnt;
+    if (info->contadores) contadores_iniciar(&cnt);
+    const trozo *z;
+    while ((z = tuberia_tomar(info->tuberia, info->id)) != NULL) {
+        if (h) histogramar(z->notas, z->cantidad, h);
+        else clasificar(z->notas, z->cantidad, &c);
+        cantidad += z->cantidad;
+        bloques++;
+        tuberia_devolver(info->tuberia, info->id, z);
+    }
+    if (info->contadores) contadores_detener(&cnt, &info->resultado->hw);
+    if (h) histograma_conteo(h, &c);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    publicar(info, &c, cantidad, bloques, info->tuberia->consumidores[info->id].espera, t0, t1);
+    return NULL;
+}
+
+/* Datos de un productor de la tubería */
+typedef struct {
+    tuberia *t;
+    int id;
+    pthread_barrier_t *barrera;
+} dato_productor;
+
+static void *producir(void *arg)
+{
+    dato_productor *d = (dato_productor *)arg;
+    pthread_barrier_wait(d->barrera);
+    pthread_barrier_wait(d->barrera);
+    tuberia_producir(d->t, d->id);
     return NULL;
 }
 
 /*
- * Muestra y guarda los resultados de cada grupo/hilo.
- * filename: nombre del archivo de salida.
- * res: arreglo de resultados de cada hilo.
- * n_hilos: cantidad de hilos/grupos.
+ * Hilo de un grupo persistente: se fija a su CPU y genera su tramo como en
+ * procesar(), y luego atiende una consulta por cada vuelta de las barreras
+ * hasta que el hilo principal pide salir.
  */
-void mostrar_y_guardar_resultados(const char *filename, resultado_hilo *res, int n_hilos, double tiempo_total, time_t inicio, time_t fin, struct timespec t0, struct timespec t1) {
-    int rewrite = 0;
-    FILE *revision = fopen(filename, "r");
-    if (revision) {
-        int lines = 0;
-        char buffer[256];
-        while (fgets(buffer, sizeof(buffer), revision)) lines++;
-        if (lines > 12) rewrite = 1;
-        fclose(revision);
-    }
-    FILE *escritura = fopen(filename, rewrite ? "w" : "a");
-    if (!escritura) { perror("fopen"); exit(EXIT_FAILURE); }
+static void *atender(void *arg)
+{
+    dato_hilo *info = (dato_hilo *)arg;
+    grupo_hilos *g = info->grupo;
+    afinidad_fijar(info->afin, info->id);
+    if (info->generar) {
+        long inicio, cantidad;
+        planificador_tramo(info->plan, info->id, &inicio, &cantidad);
+        generar_notas(info->notas, inicio, cantidad, info->semilla);
+    }
+    pthread_barrier_wait(&g->fin); // Notas listas
+    for (;;) {
+        pthread_barrier_wait(&g->inicio);
+        if (g->salir) break;
+        conteo c = {0};
+        int bloques = 0;
+        double busqueda = 0;
+        info->resultado->cantidad = recorrer(info, g->desde, &c, NULL, NULL, &bloques, &busqueda);
+        info->resultado->suma     = c.suma;
+        info->resultado->fuera    = c.fuera;
+        agregador_sumar(info->totales, info->id, &c);
+        pthread_barrier_wait(&g->fin);
+    }
+    return NULL;
+}
+
+/*
+ * Resuelve una consulta con el grupo persistente (ver atender_consulta): reparte
+ * el rango pedido, despierta a los hilos y espera a que todos terminen.
+ */
+static int consultar_hilos(void *contexto, const consulta *q, conteo *c)
+{
+    grupo_hilos *g = contexto;
+    planificador_iniciar(g->r->plan, g->modo, g->n_hilos, q->cantidad, g->tam_bloque);
+    agregador_destruir(g->r->totales);
+    agregador_iniciar(g->r->totales, g->agregacion, g->n_hilos, 0); // Totales en cero
+    g->desde = q->inicio;
+    pthread_barrier_wait(&g->inicio);
+    pthread_barrier_wait(&g->fin);
+
+    long long totales[3];
+    agregador_totales(g->r->totales, totales);
+    c->reprobados    = totales[0];
+    c->aprobado_bajo = totales[1];
+    c->aprobado_alto = totales[2];
+    c->suma = 0;
+    for (int i = 0; i < g->n_hilos; ++i) {
+        c->suma  += g->r->res[i].suma;
+        c->fuera += g->r->res[i].fuera;
+    }
+    return 0;
+}
+
+/*
+ * Crea el grupo persistente de n_hilos hilos sobre r (planificador iniciado con
+ * todas las notas) y espera a que generen sus tramos.
+ */
+static void grupo_crear(grupo_hilos *g, const recursos *r, int n_hilos, uint64_t semilla, int generar)
+{
+    g->r = r;
+    g->n_hilos = n_hilos;
+    g->salir = 0;
+    g->hilos = malloc(sizeof(pthread_t) * n_hilos);
+    g->datos = malloc(sizeof(dato_hilo) * n_hilos);
+    if (!g->hilos || !g->datos) { perror("malloc"); exit(EXIT_FAILURE); }
+    pthread_barrier_init(&g->inicio, NULL, n_hilos + 1);
+    pthread_barrier_init(&g->fin, NULL, n_hilos + 1);
     for (int i = 0; i < n_hilos; ++i) {
-        char letra = 'A' + i;
-        fprintf(escritura,
-                "Grupo %c | Promedio: %.2f | Reprobados: %d | Aprobados (18-27.99): %d | Aprobados (28-40): %d | Tiempo: %.6f s\n",
-                letra, res[i].promedio, res[i].reprobados,
-                res[i].aprobado_bajo, res[i].aprobado_alto, res[i].tiempo);
+        g->datos[i] = (dato_hilo){ .id = i, .notas = r->notas, .ventanas = r->ventanas,
+                                   .plan = r->plan, .afin = r->afin,
+                                   .semilla = semilla, .generar = generar,
+                                   .totales = r->totales, .resultado = &r->res[i], .grupo = g };
+        if (pthread_create(&g->hilos[i], NULL, atender, &g->datos[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
     }
-    // Escribe el tiempo de inicio y fin en formato legible con nanosegundos
-    char buf_inicio[64], buf_fin[64];
-    strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&inicio));
-    strftime(buf_fin, sizeof(buf_fin), "%a %b %d %H:%M:%S", localtime(&fin));
-    fprintf(escritura, "Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&inicio)->tm_year);
-    fprintf(escritura, "Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&fin)->tm_year);
-    fprintf(escritura, "Duración total: %.6f segundos\n", tiempo_total);
-    fflush(escritura);
-    fclose(escritura);
+    pthread_barrier_wait(&g->fin); // Todos generaron su tramo
 }
 
-int main(void)
+/* Pide a los hilos del grupo que terminen y los espera */
+static void grupo_destruir(grupo_hilos *g)
 {
-    /* Hilos a utilizar = núcleos lógicos */
-    int n_hilos = 8;
-    if (n_hilos < 1) n_hilos = 8; /* respaldo */
+    g->salir = 1;
+    pthread_barrier_wait(&g->inicio);
+    for (int i = 0; i < g->n_hilos; ++i)
+        pthread_join(g->hilos[i], NULL);
+    pthread_barrier_destroy(&g->inicio);
+    pthread_barrier_destroy(&g->fin);
+    free(g->hilos);
+    free(g->datos);
+}
 
-    long notas_por_hilo = TOTAL_NOTAS / n_hilos; // Notas por hilo
-    long resto          = TOTAL_NOTAS % n_hilos; // Resto para el último hilo
+/* Notas fuera de rango que contaron los hilos (solo puede haber si vienen de un archivo) */
+static long long fuera_de_rango(const resultado_hilo *res, int n_hilos)
+{
+    long long fuera = 0;
+    for (int i = 0; i < n_hilos; ++i) fuera += res[i].fuera;
+    return fuera;
+}
 
-    /* Generar notas aleatorias */
-    int *notas = malloc(sizeof(int) * TOTAL_NOTAS); // Puntero a arreglo dinámico
-    if (!notas) { perror("malloc"); return EXIT_FAILURE; }
-    srand((unsigned)time(NULL));
-    for (long i = 0; i < TOTAL_NOTAS; ++i)
-        notas[i] = rand() % (MAX_NOTA + 1);
+/*
+ * Inactividad: lo que cada hilo esperó al último en terminar más lo que pasó
+ * buscando bloques. Retorna el momento en que terminó el último.
+ */
+static struct timespec marcar_inactividad(resultado_hilo *res, int n_hilos)
+{
+    struct timespec ultimo = res[0].fin;
+    for (int i = 1; i < n_hilos; ++i)
+        if (segundos_entre(ultimo, res[i].fin) > 0) ultimo = res[i].fin;
+    for (int i = 0; i < n_hilos; ++i)
+        res[i].inactivo = segundos_entre(res[i].fin, ultimo) + res[i].busqueda;
+    return ultimo;
+}
 
+/*
+ * Lanza n_hilos hilos sobre las notas de r y espera a que terminen.
+ * r: notas, planificador y agregador ya iniciados para n_hilos trabajadores;
+ * en r->res queda el resultado de cada hilo (incluida su inactividad).
+ * generar: 1 si cada hilo genera su tramo antes de procesarlo (con semilla).
+ * t0, t1: marcas de inicio y fin del procesamiento (cómputo y reducción, sin la generación).
+ * tiempo_inicio: hora del sistema al comenzar el procesamiento (puede ser NULL).
+ * f: duración de cada fase salvo el reporte, que mide quien imprime.
+ */
+static void ejecutar_hilos(const recursos *r, int n_hilos, uint64_t semilla, int generar,
+                           struct timespec *t0, struct timespec *t1, time_t *tiempo_inicio, fases *f)
+{
+    resultado_hilo *res = r->res;
     pthread_t   *hilos = malloc(sizeof(pthread_t) * n_hilos); // Puntero a arreglo de hilos
     dato_hilo     *dato_por_hilo = malloc(sizeof(dato_hilo)  * n_hilos); // Puntero a datos de cada hilo
-    resultado_hilo *res   = calloc(n_hilos, sizeof(resultado_hilo)); // Puntero a resultados
+    if (!hilos || !dato_por_hilo) { perror("malloc"); exit(EXIT_FAILURE); }
 
-    /* Medición de tiempo total */
-    struct timespec t0, t1;
-    clock_gettime(CLOCK_MONOTONIC, &t0); // Marca de tiempo inicial
-    time_t tiempo_inicio = time(NULL);
+    // Barrera de n_hilos + 1: el hilo principal marca el inicio cuando todos generaron
+    pthread_barrier_t barrera, mezcla;
+    pthread_barrier_init(&barrera, NULL, n_hilos + 1);
+    if (r->claves) pthread_barrier_init(&mezcla, NULL, n_hilos); // Solo entre los hilos
+
+    struct timespec tg0, tl1;
+    clock_gettime(CLOCK_MONOTONIC, &tg0); // Inicio del lanzamiento (y de la generación)
 
-    long idx = 0;
     for (int i = 0; i < n_hilos; ++i) {
-        long cant = notas_por_hilo + (i == n_hilos - 1 ? resto : 0); // Cantidad para este hilo
         // Inicializa la estructura de datos para el hilo
-        dato_por_hilo[i] = (dato_hilo){ .id = i, .notas = notas,
-                              .inicio = idx, .cantidad = cant,
-                              .resultado = &res[i] };
+        dato_por_hilo[i] = (dato_hilo){ .id = i, .notas = r->notas, .ventanas = r->ventanas,
+                              .plan = r->plan, .afin = r->afin,
+                              .semilla = semilla, .generar = generar,
+                              .claves = r->claves, .secciones = r->secciones,
+                              .histograma = r->histograma, .desde = r->desde, .contadores = r->contadores, .barrera = &barrera, .mezcla = &mezcla,
+                              .salida = r->salida, .totales = r->totales, .resultado = &res[i], .todos = res };
         // pthread_create: crea un hilo
         // &hilos[i]: puntero al identificador del hilo
         // NULL: atributos por defecto
@@ -140,37 +466,284 @@ int main(void)
         // &dato_por_hilo[i]: puntero a los datos del hilo
         if (pthread_create(&hilos[i], NULL, procesar, &dato_por_hilo[i]) != 0) {
             perror("pthread_create");
-            return EXIT_FAILURE;
+            exit(EXIT_FAILURE);
         }
-        idx += cant;
     }
+    clock_gettime(CLOCK_MONOTONIC, &tl1); // Fin del lanzamiento
+
+    /* Medición de tiempo total (sin la generación): se marca entre las dos esperas
+       para que ningún hilo empiece a procesar antes de la marca inicial */
+    pthread_barrier_wait(&barrera);
+    clock_gettime(CLOCK_MONOTONIC, t0); // Marca de tiempo inicial
+    if (tiempo_inicio) *tiempo_inicio = time(NULL);
+    pthread_barrier_wait(&barrera);
 
     // Espera a que todos los hilos terminen
     for (int i = 0; i < n_hilos; ++i)
         pthread_join(hilos[i], NULL);
 
-    clock_gettime(CLOCK_MONOTONIC, &t1); // Marca de tiempo final
+    clock_gettime(CLOCK_MONOTONIC, t1); // Marca de tiempo final
+
+    struct timespec ultimo = marcar_inactividad(res, n_hilos);
+    pthread_barrier_destroy(&barrera);
+    if (r->claves) pthread_barrier_destroy(&mezcla);
+    free(hilos);
+    free(dato_por_hilo);
+
+    f->lanzamiento = segundos_entre(tg0, tl1);
+    f->generacion  = segundos_entre(tl1, *t0);
+    f->computo     = segundos_entre(*t0, ultimo);
+    f->reduccion   = segundos_entre(ultimo, *t1);
+    f->reporte     = 0;
+}
+
+/*
+ * Como ejecutar_hilos(), pero las notas no están en memoria de antemano: los
+ * productores de t generan o leen trozos mientras n_hilos consumidores los
+ * procesan, así que no hay fase de generación separada del cómputo.
+ */
+static void ejecutar_tuberia(const recursos *r, int n_hilos, tuberia *t,
+                             struct timespec *t0, struct timespec *t1, time_t *tiempo_inicio, fases *f)
+{
+    resultado_hilo *res = r->res;
+    int n_productores = t->n_productores;
+    pthread_t *hilos = malloc(sizeof(pthread_t) * (n_hilos + n_productores));
+    dato_hilo *dato_por_hilo = malloc(sizeof(dato_hilo) * n_hilos);
+    dato_productor *dato_por_productor = malloc(sizeof(dato_productor) * n_productores);
+    if (!hilos || !dato_por_hilo || !dato_por_productor) { perror("malloc"); exit(EXIT_FAILURE); }
+
+    // Productores y consumidores empiezan juntos cuando el hilo principal marca el inicio
+    pthread_barrier_t barrera;
+    pthread_barrier_init(&barrera, NULL, n_hilos + n_productores + 1);
+    struct timespec tg0, tl1;
+    clock_gettime(CLOCK_MONOTONIC, &tg0);
+    for (int i = 0; i < n_hilos; ++i) {
+        dato_por_hilo[i] = (dato_hilo){ .id = i, .afin = r->afin, .histograma = r->histograma, .contadores = r->contadores,
+                                        .barrera = &barrera, .totales = r->totales, .resultado = &res[i],
+                                        .todos = res, .tuberia = t };
+        if (pthread_create(&hilos[i], NULL, consumir, &dato_por_hilo[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < n_productores; ++i) {
+        dato_por_productor[i] = (dato_productor){ .t = t, .id = i, .barrera = &barrera };
+        if (pthread_create(&hilos[n_hilos + i], NULL, producir, &dato_por_productor[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tl1);
+
+    pthread_barrier_wait(&barrera);
+    clock_gettime(CLOCK_MONOTONIC, t0);
+    if (tiempo_inicio) *tiempo_inicio = time(NULL);
+    pthread_barrier_wait(&barrera);
+    for (int i = 0; i < n_hilos + n_productores; ++i)
+        pthread_join(hilos[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, t1);
+
+    struct timespec ultimo = marcar_inactividad(res, n_hilos);
+    pthread_barrier_destroy(&barrera);
+    free(hilos);
+    free(dato_por_hilo);
+    free(dato_por_productor);
+
+    f->lanzamiento = segundos_entre(tg0, tl1);
+    f->generacion  = segundos_entre(tl1, *t0);   // Solo la espera en la barrera: se genera en el cómputo
+    f->computo     = segundos_entre(*t0, ultimo);
+    f->reduccion   = segundos_entre(ultimo, *t1);
+    f->reporte     = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    opciones op;
+    parsear_opciones(argc, argv, &op);
+    if (op.exportar) {
+        // Solo escribe el conjunto de datos generado y termina
+        if (archivo_exportar(op.exportar, op.total, op.semilla, op.secciones) != 0) { perror(op.exportar); return EXIT_FAILURE; }
+        printf("Exportadas %ld notas a %s (semilla %llu)\n", op.total, op.exportar, (unsigned long long)op.semilla);
+        if (op.secciones) printf("Con una clave por nota entre 0 y %u\n", op.secciones - 1);
+        return EXIT_SUCCESS;
+    }
+    const char *kernel = seleccionar_kernel(op.kernel);
+    if (!kernel) { fprintf(stderr, "Kernel no disponible: %s\n", op.kernel); return EXIT_FAILURE; }
+    static afinidad afin;   // Topología y CPUs para cada hilo
+    if (afinidad_preparar(&afin, op.afinidad) != 0) { fprintf(stderr, "Afinidad inválida: %s\n", op.afinidad); return EXIT_FAILURE; }
 
-    double duracion_total = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    /* Hilos a utilizar = núcleos lógicos (o los pedidos con --trabajadores) */
+    int n_hilos = op.trabajadores;
+
+    recursos r = { .afin = &afin, .histograma = op.histograma, .contadores = op.contadores, .salida = -1 };
+    archivo_notas archivo;
+    long total = op.total;  // Notas a procesar
+    int generar = 1;        // Las notas se generan salvo que vengan de un archivo
+    long tam_bloque = op.bloque_kib * 1024 / (long)sizeof(nota_t);
+    if (op.archivo) {
+        // Notas de un archivo: mapeado completo o, con --ventana, bloque a bloque (con --tuberia se leen por trozos)
+        if (archivo_abrir(&archivo, op.archivo, op.ventana_mib == 0 && !op.tuberia) != 0) return EXIT_FAILURE;
+        total = archivo.cantidad;
+        generar = 0;
+        r.notas = archivo.notas;
+        if (op.ventana_mib) {
+            r.ventanas = &archivo;
+            tam_bloque = op.ventana_mib * 1024 * 1024 / (long)sizeof(nota_t);
+        }
+    } else if (!op.tuberia) {
+        /* Las notas las genera cada hilo sobre su propio tramo: con afinidad, cada
+           página se asigna en el nodo NUMA del hilo que la toca primero */
+        r.notas = malloc(sizeof(nota_t) * total); // Puntero a arreglo dinámico
+        if (!r.notas) { perror("malloc"); return EXIT_FAILURE; }
+    }
+    if (op.agrupar) {
+        // Claves del archivo o generadas por cada hilo junto con su tramo de notas
+        if (op.archivo && !archivo.con_claves) {
+            fprintf(stderr, "%s: el archivo no trae claves (expórtelo con --secciones)\n", op.archivo);
+            return EXIT_FAILURE;
+        }
+        r.secciones = op.archivo ? archivo.secciones : op.secciones ? op.secciones : SECCIONES_DEFECTO;
+        r.claves = op.archivo ? archivo.claves : malloc(sizeof(clave_t) * total);
+        if (!r.claves) { perror("malloc"); return EXIT_FAILURE; }
+        if (op.salida_grupos && (r.salida = grupos_abrir_salida(op.salida_grupos)) < 0) return EXIT_FAILURE;
+    }
+    // Con una instantánea ya guardada solo se procesan las notas agregadas desde entonces
+    instantanea snap = {0};
+    int incremental = 0;
+    if (op.instantanea) {
+        uint64_t semilla = op.archivo ? archivo.semilla : op.semilla;
+        incremental = instantanea_leer(op.instantanea, &snap, total, semilla, op.archivo);
+        if (incremental < 0) return EXIT_FAILURE;
+        if (!incremental) instantanea_crear(&snap, semilla, op.archivo != NULL);
+        r.desde = (long)snap.cab.cantidad;
+    }
+    if (planificador_admite(total, tam_bloque) != 0) {
+        fprintf(stderr, "Demasiados bloques: %ld notas en bloques de %ld (máximo %u); use bloques mayores\n",
+                total, tam_bloque, UINT32_MAX);
+        return EXIT_FAILURE;
+    }
+    // Resultados alineados a línea de caché: cada hilo escribe solo la suya
+    resultado_hilo *res = r.res = aligned_alloc(LINEA_CACHE, sizeof(resultado_hilo) * n_hilos); // Puntero a resultados
+    if (!res) { perror("aligned_alloc"); return EXIT_FAILURE; }
+    agregador *totales = r.totales = agregador_nuevo(op.agregacion, n_hilos);
+    if (!totales) { perror("aligned_alloc"); return EXIT_FAILURE; }
+    // Bloques del tamaño de la caché: robo de trabajo entre las colas de los hilos
+    modo_reparto modo = op.estatico ? REPARTO_ESTATICO : REPARTO_ROBO;
+    planificador *plan = r.plan = planificador_nuevo(modo, n_hilos, total - r.desde, tam_bloque);
+    if (!plan) { perror("aligned_alloc"); return EXIT_FAILURE; }
+    // Con --tuberia las notas pasan por trozos del tamaño de bloque y nunca están todas en memoria
+    tuberia tub = {0};
+    if (op.tuberia && tuberia_iniciar(&tub, op.productores, n_hilos, tam_bloque, r.desde, total,
+                                      op.archivo ? archivo.fd : -1, op.semilla) != 0) {
+        perror("aligned_alloc");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec t0, t1;
+    fases f;
+    if (op.servir) {
+        // Los hilos y las notas se crean una vez; después solo se atienden consultas
+        grupo_hilos g = { .modo = modo, .tam_bloque = tam_bloque, .agregacion = op.agregacion };
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        grupo_crear(&g, &r, n_hilos, op.semilla, generar);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(stderr, "Grupo de %d hilos listo en %.6f segundos (lanzamiento y %s)\n", n_hilos,
+                segundos_entre(t0, t1), generar ? "generación" : "mapeo");
+        int error = servir(op.socket, total, consultar_hilos, &g, "HILOS");
+        grupo_destruir(&g);
+        agregador_destruir(totales);
+        free(totales);
+        free(plan);
+        if (op.archivo) archivo_cerrar(&archivo);
+        else free(r.notas);
+        free(res);
+        return error ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (op.barrido) {
+        // Genera una sola vez con todos los hilos y mide cada nivel sobre los mismos datos
+        ejecutar_hilos(&r, n_hilos, op.semilla, generar, &t0, &t1, NULL, &f);
+        if (archivo_fuera_de_rango(op.archivo, fuera_de_rango(res, n_hilos)) != 0) return EXIT_FAILURE;
+        double duracion_generacion = f.generacion;
+        agregador_destruir(totales);
+        int niveles[33];
+        double tiempos[33], esperas[33];
+        int n_niveles = barrido_niveles(n_hilos, niveles);
+        for (int i = 0; i < n_niveles; ++i) {
+            agregador_iniciar(totales, op.agregacion, niveles[i], 0);
+            planificador_iniciar(plan, modo, niveles[i], total, tam_bloque);
+            ejecutar_hilos(&r, niveles[i], op.semilla, 0, &t0, &t1, NULL, &f);
+            tiempos[i] = segundos_entre(t0, t1);
+            esperas[i] = agregador_espera_maxima(totales);
+            agregador_destruir(totales);
+        }
+        barrido_imprimir("HILOS", niveles, tiempos, esperas, n_niveles);
+        if (generar)
+            printf("Generación: %.6f segundos (semilla %llu)\n", duracion_generacion, (unsigned long long)op.semilla);
+        free(totales);
+        free(plan);
+        if (op.archivo) archivo_cerrar(&archivo);
+        else free(r.notas);
+        free(res);
+        return EXIT_SUCCESS;
+    }
+
+    time_t tiempo_inicio;
+    if (op.tuberia) ejecutar_tuberia(&r, n_hilos, &tub, &t0, &t1, &tiempo_inicio, &f);
+    else ejecutar_hilos(&r, n_hilos, op.semilla, generar, &t0, &t1, &tiempo_inicio, &f);
+    if (archivo_fuera_de_rango(op.archivo, fuera_de_rango(res, n_hilos)) != 0) return EXIT_FAILURE;
+    double duracion_generacion = f.generacion;
+
+    double duracion_total = segundos_entre(t0, t1);
     time_t tiempo_fin = time(NULL);
-    // Escribe los resultados ANTES de leerlos para imprimir
-    mostrar_y_guardar_resultados("resultados_hilos.txt", res, n_hilos, duracion_total, tiempo_inicio, tiempo_fin, t0, t1);
+    // Histograma global: mezcla de los 41 contadores de cada hilo
+    histograma hist = {0};
+    if (op.histograma)
+        for (int i = 0; i < n_hilos; ++i) histograma_sumar(&hist, &res[i].hist);
+    long long resumen_global[3];
+    agregador_totales(totales, resumen_global);
+    long base = r.desde;
+    correcciones corr = {0};   // Se escriben en el archivo recién con la instantánea guardada
+    if (op.instantanea) {
+        // Lo procesado se pliega en la instantánea y los totales pasan a ser los de todas las notas
+        for (int i = 0; i < n_hilos; ++i) instantanea_plegar(&snap, &res[i].hist);
+        instantanea_avanzar(&snap, total);
+        if (op.correcciones && instantanea_corregir(&snap, op.correcciones, op.archivo, &corr) != 0)
+            return EXIT_FAILURE;
+        instantanea_total(&snap, &hist);
+        conteo c = {0};
+        histograma_conteo(&hist, &c);
+        resumen_global[0] = c.reprobados;
+        resumen_global[1] = c.aprobado_bajo;
+        resumen_global[2] = c.aprobado_alto;
+    }
+    // Los resultados se imprimen desde memoria; el historial se escribe una sola vez al final
+    registro_grupo *grupos = malloc(sizeof(registro_grupo) * n_hilos);
+    medicion_hw *mediciones = malloc(sizeof(medicion_hw) * n_hilos); // Copia: --verificar reutiliza res
+    if (!grupos || !mediciones) { perror("malloc"); return EXIT_FAILURE; }
     printf("\n=== HILOS ===\n");
-    // Imprime solo las primeras 8 líneas del archivo de resultados
-    FILE *escritura = fopen("resultados_hilos.txt", "r");
-    if (escritura) {
-        char line[256];
-        int count = 0;
-        while (fgets(line, sizeof line, escritura) && count < 8) {
-            printf("%s", line);
-            count++;
-        }
-        fclose(escritura);
+    for (int i = 0; i < n_hilos; ++i) {
+        mediciones[i] = res[i].hw;
+        grupos[i] = (registro_grupo){ .promedio = res[i].promedio, .reprobados = res[i].reprobados,
+                                      .aprobado_bajo = res[i].aprobado_bajo, .aprobado_alto = res[i].aprobado_alto,
+                                      .cantidad = res[i].cantidad, .tiempo = res[i].tiempo, .espera = res[i].espera,
+                                      .bloques = res[i].bloques, .inactivo = res[i].inactivo, .cpu = res[i].cpu,
+                                      .hw = op.contadores ? &mediciones[i] : NULL };
+        etiqueta_grupo(i, grupos[i].etiqueta);
+        registro_imprimir_grupo(stdout, &grupos[i]);
+    }
+    printf("\n=== Totales Globales (%s) ===\n", agregacion_nombre(totales->modo));
+    printf("Reprobados: %lld\n", resumen_global[0]);
+    printf("Aprobados (18-27.99): %lld\n", resumen_global[1]);
+    printf("Aprobados (28-40): %lld\n", resumen_global[2]);
+    agregador_imprimir_esperas(totales);
+    if (op.histograma) histograma_imprimir(&hist, op.cortes, op.n_cortes);
+    if (op.tuberia) tuberia_imprimir(&tub);
+    // Agrupación por clave: cada hilo mezcló y resumió una partición
+    resumen_grupos agrupacion = {0};
+    if (op.agrupar) {
+        for (int i = 0; i < n_hilos; ++i) grupos_combinar(&agrupacion, &res[i].grupos);
+        grupos_imprimir(&agrupacion, n_hilos, op.salida_grupos);
     }
-    printf("\n=== Totales Globales (con mutex) ===\n");
-    printf("Reprobados: %d\n", resumen_global[0]);
-    printf("Aprobados (18-27.99): %d\n", resumen_global[1]);
-    printf("Aprobados (28-40): %d\n", resumen_global[2]);
     printf("\n=== Resumen (HILOS) ===\n");
     char buf_inicio[64], buf_fin[64];
     strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&tiempo_inicio));
@@ -178,12 +751,100 @@ int main(void)
     printf("Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&tiempo_inicio)->tm_year);
     printf("Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&tiempo_fin)->tm_year);
     printf("Duración total: %.6f segundos\n", duracion_total);
-    pthread_mutex_destroy(&resumen_mutex); // Libera el mutex
+    printf("Ancho de banda: %.2f GB/s (kernel %s, %zu byte(s) por nota)\n",
+           gbps(total - r.desde, duracion_total), kernel, sizeof(nota_t));
+    if (op.tuberia && generar)
+        printf("Generación: dentro del cómputo, por %d productores (semilla %llu)\n", tub.n_productores,
+               (unsigned long long)op.semilla);
+    else if (generar)
+        printf("Generación: %.6f segundos (semilla %llu)\n", duracion_generacion, (unsigned long long)op.semilla);
+    else
+        printf("Datos: %s (%ld notas, %s)\n", op.archivo, total,
+               op.tuberia ? "leído por trozos con pread" : op.ventana_mib ? "por ventanas" : "mapeado completo");
+    const char *reparto = op.tuberia ? "tubería" : reparto_nombre(modo);
+    printf("Reparto: %s, %ld bloques de %ld KiB\n", reparto, op.tuberia ? tub.n_bloques : plan->n_bloques,
+           tam_bloque * (long)sizeof(nota_t) / 1024);
 
-    free(notas);  // Libera memoria dinámica
-    free(hilos);
-    free(dato_por_hilo);
+    // Ancho de banda por nodo NUMA según la CPU donde terminó cada hilo
+    int *cpus = malloc(sizeof(int) * n_hilos);
+    long *cantidades = malloc(sizeof(long) * n_hilos);
+    double *tiempos = malloc(sizeof(double) * n_hilos);
+    if (!cpus || !cantidades || !tiempos) { perror("malloc"); return EXIT_FAILURE; }
+    for (int i = 0; i < n_hilos; ++i) {
+        cpus[i] = res[i].cpu;
+        cantidades[i] = res[i].cantidad;
+        tiempos[i] = res[i].tiempo;
+    }
+    afinidad_imprimir_nodos(&afin, cpus, cantidades, tiempos, n_hilos);
+    if (op.contadores) contadores_imprimir(mediciones, cantidades, n_hilos);
+    free(cpus);
+    free(cantidades);
+    free(tiempos);
+
+    // El reporte va desde el fin de la reducción hasta aquí
+    struct timespec t_reporte;
+    clock_gettime(CLOCK_MONOTONIC, &t_reporte);
+    f.reporte = segundos_entre(t1, t_reporte);
+    printf("\n");
+    imprimir_fases(&f);
+
+    int estado = EXIT_SUCCESS;
+    if (op.instantanea) {
+        instantanea_imprimir(&snap, op.instantanea, base, corr.n, duracion_total);
+        if (op.verificar) {
+            // Recálculo completo con los mismos hilos sobre todas las notas; el archivo
+            // todavía no tiene las correcciones, así que se le aplican al resultado
+            agregador_destruir(totales);
+            agregador_iniciar(totales, op.agregacion, n_hilos, 0);
+            planificador_iniciar(plan, modo, n_hilos, total, tam_bloque);
+            recursos completo = r;
+            completo.desde = 0;
+            struct timespec v0, v1;
+            fases fv;
+            ejecutar_hilos(&completo, n_hilos, op.semilla, generar, &v0, &v1, NULL, &fv);
+            histograma recalculado = {0};
+            for (int i = 0; i < n_hilos; ++i) histograma_sumar(&recalculado, &res[i].hist);
+            correcciones_aplicar(&corr, &recalculado);
+            if (instantanea_verificar(&hist, &recalculado, duracion_total, segundos_entre(v0, v1)) != 0)
+                estado = EXIT_FAILURE;
+        }
+        // Si no coincide se conservan la instantánea anterior y el archivo sin corregir
+        if (estado == EXIT_SUCCESS && instantanea_guardar(op.instantanea, &snap, op.archivo, &corr) != 0) {
+            perror(op.instantanea);
+            estado = EXIT_FAILURE;
+        }
+        if (estado == EXIT_SUCCESS && corr.n > 0
+            && instantanea_escribir_correcciones(&snap, op.instantanea, &corr, op.archivo) != 0)
+            estado = EXIT_FAILURE;
+        correcciones_liberar(&corr);
+    }
+
+    if (op.historial) {
+        registro_corrida reg = { .motor = "hilos", .kernel = kernel, .agregacion = agregacion_nombre(totales->modo),
+                                 .reparto = reparto, .afinidad = op.afinidad,
+                                 .datos = op.archivo ? op.archivo : "generadas", .semilla = op.semilla,
+                                 .trabajadores = n_hilos, .total = total,
+                                 .bloque_kib = tam_bloque * (long)sizeof(nota_t) / 1024,
+                                 .inicio = tiempo_inicio, .duracion = duracion_total, .f = f,
+                                 .totales = { resumen_global[0], resumen_global[1], resumen_global[2] },
+                                 .hist = op.histograma ? &hist : NULL, .agrupacion = op.agrupar ? &agrupacion : NULL,
+                                 .n_grupos = n_hilos, .grupos = grupos };
+        if (registro_agregar(op.historial, &reg) != 0) perror(op.historial);
+    }
+    free(grupos);
+    free(mediciones);
+    agregador_destruir(totales); // Libera el mutex
+    free(totales);
+    free(plan);
+
+    if (r.salida >= 0) close(r.salida);
+    if (op.archivo) archivo_cerrar(&archivo);
+    else {
+        free(r.notas);  // Libera memoria dinámica
+        free(r.claves);
+    }
+    tuberia_liberar(&tub);
     free(res);
-    return EXIT_SUCCESS;
+    return estado;
 }
 
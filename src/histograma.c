@@ -0,0 +1,176 @@
+#include "histograma.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NOTAS_INT32
+/* Clase de una nota: su valor, o N_CLASES si está fuera de [0, MAX_NOTA] */
+static inline unsigned clase(nota_t n)
+{
+    return (unsigned)n <= MAX_NOTA ? (unsigned)n : N_CLASES;
+}
+
+/*
+ * Cuatro histogramas parciales: notas iguales seguidas caen en contadores
+ * distintos y no esperan a que se guarde el incremento anterior.
+ */
+void histogramar(const nota_t *notas, long cantidad, histograma *h)
+{
+    long long parcial[4][N_CLASES + 1] = {{0}};
+    long i = 0;
+    for (; i + 4 <= cantidad; i += 4) {
+        parcial[0][clase(notas[i])]++;
+        parcial[1][clase(notas[i + 1])]++;
+        parcial[2][clase(notas[i + 2])]++;
+        parcial[3][clase(notas[i + 3])]++;
+    }
+    for (; i < cantidad; ++i)
+        parcial[0][clase(notas[i])]++;
+    for (int k = 0; k < N_CLASES; ++k)
+        h->cuenta[k] += parcial[0][k] + parcial[1][k] + parcial[2][k] + parcial[3][k];
+    h->fuera += parcial[0][N_CLASES] + parcial[1][N_CLASES] + parcial[2][N_CLASES] + parcial[3][N_CLASES];
+}
+#else
+#define NOTAS_POR_TANDA (1L << 30)   // Cabe en los contadores de 32 bits
+
+/*
+ * Notas de un byte: se leen de a 8 con una carga de 64 bits y cada byte indexa
+ * directo una tabla de 256 contadores de 32 bits (sin comparar con MAX_NOTA).
+ * Cuatro tablas parciales evitan que notas iguales seguidas esperen una a otra
+ * el incremento anterior; al final se pliegan sobre las 41 clases. Medido en un
+ * hilo sobre 16 MiB: con notas iguales 1.24 GB/s contra 0.36 de una sola tabla,
+ * con notas aleatorias 1.5-1.7 contra 1.45-1.5. Igual queda por debajo de los
+ * kernels de clasificación (microbench: unos 2 GB/s escalar, 14-24 avx2), que
+ * siguen siendo el camino por defecto. Contar con avx2 (41 comparaciones por
+ * vector en contadores de byte) no lo mejora: unos 1.3 GB/s en la misma máquina.
+ */
+void histogramar(const nota_t *notas, long cantidad, histograma *h)
+{
+    uint32_t parcial[4][256];
+    long i = 0;
+    while (i < cantidad) {
+        memset(parcial, 0, sizeof(parcial));
+        long fin = cantidad - i > NOTAS_POR_TANDA ? i + NOTAS_POR_TANDA : cantidad;
+        for (; i + 8 <= fin; i += 8) {
+            uint64_t x;
+            memcpy(&x, notas + i, sizeof(x));
+            parcial[0][x & 0xff]++;
+            parcial[1][(x >> 8) & 0xff]++;
+            parcial[2][(x >> 16) & 0xff]++;
+            parcial[3][(x >> 24) & 0xff]++;
+            parcial[0][(x >> 32) & 0xff]++;
+            parcial[1][(x >> 40) & 0xff]++;
+            parcial[2][(x >> 48) & 0xff]++;
+            parcial[3][x >> 56]++;
+        }
+        for (; i < fin; ++i)
+            parcial[0][notas[i]]++;
+        for (int k = 0; k < 256; ++k) {
+            long long suma = (long long)parcial[0][k] + parcial[1][k] + parcial[2][k] + parcial[3][k];
+            if (k < N_CLASES) h->cuenta[k] += suma;
+            else h->fuera += suma;
+        }
+    }
+}
+#endif
+
+void histograma_sumar(histograma *destino, const histograma *origen)
+{
+    for (int k = 0; k < N_CLASES; ++k)
+        destino->cuenta[k] += origen->cuenta[k];
+    destino->fuera += origen->fuera;
+}
+
+void histograma_conteo(const histograma *h, conteo *c)
+{
+    for (int k = 0; k < N_CLASES; ++k) {
+        c->suma += (long long)k * h->cuenta[k];
+        if (k < 18) c->reprobados += h->cuenta[k];
+        else if (k < 28) c->aprobado_bajo += h->cuenta[k];
+        else c->aprobado_alto += h->cuenta[k];
+    }
+    c->fuera += h->fuera;
+}
+
+/* Nota en la posición k (1..n) si las notas estuvieran ordenadas */
+static int k_esima(const histograma *h, long long k)
+{
+    long long acumulado = 0;
+    for (int v = 0; v < N_CLASES; ++v) {
+        acumulado += h->cuenta[v];
+        if (acumulado >= k) return v;
+    }
+    return MAX_NOTA;
+}
+
+void histograma_resumir(const histograma *h, resumen_notas *r)
+{
+    *r = (resumen_notas){ .minimo = -1, .maximo = -1 };
+    long long suma = 0;
+    for (int k = 0; k < N_CLASES; ++k) {
+        if (!h->cuenta[k]) continue;
+        if (r->minimo < 0) r->minimo = k;
+        r->maximo = k;
+        r->n += h->cuenta[k];
+        suma += (long long)k * h->cuenta[k];
+    }
+    if (r->n == 0) { r->minimo = r->maximo = 0; return; }
+    r->media = (double)suma / r->n;
+    double cuadrados = 0;
+    for (int k = 0; k < N_CLASES; ++k)
+        cuadrados += h->cuenta[k] * (k - r->media) * (k - r->media);
+    r->varianza = cuadrados / r->n;
+    r->mediana = r->n % 2 ? k_esima(h, (r->n + 1) / 2)
+                          : (k_esima(h, r->n / 2) + k_esima(h, r->n / 2 + 1)) / 2.0;
+}
+
+int histograma_percentil(const histograma *h, double p)
+{
+    long long n = 0;
+    for (int k = 0; k < N_CLASES; ++k) n += h->cuenta[k];
+    if (n == 0) return -1;
+    long long rango = (long long)ceil(p / 100.0 * n);
+    return k_esima(h, rango < 1 ? 1 : rango);
+}
+
+int leer_cortes(const char *texto, int *cortes)
+{
+    int n = 0;
+    const char *p = texto;
+    while (*p) {
+        char *fin;
+        long v = strtol(p, &fin, 10);
+        if (fin == p || v < 1 || v > MAX_NOTA || (n > 0 && v <= cortes[n - 1]) || n == MAX_NOTA) return -1;
+        cortes[n++] = (int)v;
+        if (*fin == ',') fin++;
+        else if (*fin != '\0') return -1;
+        p = fin;
+    }
+    return n > 0 ? n : -1;
+}
+
+void histograma_imprimir(const histograma *h, const int *cortes, int n_cortes)
+{
+    static const double percentiles[] = { 1, 5, 10, 25, 75, 90, 95, 99 };
+    resumen_notas r;
+    histograma_resumir(h, &r);
+    printf("\n=== Histograma (%lld notas, %d clases) ===\n", r.n, N_CLASES);
+    printf("Mínimo: %d | Máximo: %d | Media: %.4f | Varianza: %.4f | Desviación: %.4f | Mediana: %.1f\n",
+           r.minimo, r.maximo, r.media, r.varianza, sqrt(r.varianza), r.mediana);
+    printf("Percentiles:");
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+        printf("%s p%g %d", i ? " |" : "", percentiles[i], histograma_percentil(h, percentiles[i]));
+    printf("\n");
+    // Tramos [0, c1), [c1, c2), ..., [cn, MAX_NOTA]
+    for (int t = 0; t <= n_cortes; ++t) {
+        int desde = t ? cortes[t - 1] : 0;
+        int hasta = t < n_cortes ? cortes[t] : MAX_NOTA + 1;
+        long long cuantas = 0;
+        for (int k = desde; k < hasta; ++k) cuantas += h->cuenta[k];
+        printf("Tramo [%d, %d%c: %lld (%.2f%%)\n", desde, t < n_cortes ? hasta : MAX_NOTA,
+               t < n_cortes ? ')' : ']', cuantas, r.n ? 100.0 * cuantas / r.n : 0.0);
+    }
+    if (h->fuera) printf("Fuera de [0, %d]: %lld\n", MAX_NOTA, h->fuera);
+}
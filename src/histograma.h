@@ -0,0 +1,61 @@
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+#include "clasificacion.h"
+
+#define N_CLASES (MAX_NOTA + 1)   // Una clase por nota posible: 0..MAX_NOTA
+
+/*
+ * Histograma de notas: cuántas veces aparece cada nota. Con MAX_NOTA = 40 son
+ * 41 contadores, así que cada trabajador tiene el suyo y mezclarlos es barato.
+ * Las notas fuera de [0, MAX_NOTA] (un archivo ajeno) se cuentan aparte.
+ */
+typedef struct {
+    long long cuenta[N_CLASES];
+    long long fuera;          // Notas fuera de rango (no entran en las estadísticas)
+} histograma;
+
+/* Estadísticas exactas que se obtienen del histograma sin recorrer ni ordenar las notas */
+typedef struct {
+    long long n;              // Notas dentro de rango
+    int minimo, maximo;
+    double media;
+    double varianza;          // Varianza poblacional
+    double mediana;           // Promedio de los dos centrales si n es par
+} resumen_notas;
+
+/* Acumula en h el histograma de notas[0 .. cantidad) en una sola pasada */
+void histogramar(const nota_t *notas, long cantidad, histograma *h);
+
+/* Suma el histograma origen al destino (mezcla de trabajadores) */
+void histograma_sumar(histograma *destino, const histograma *origen);
+
+/*
+ * Suma a c la suma de notas y las tres categorías de siempre (<18, 18-27, >=28).
+ * Las notas de h->fuera no entran: el promedio se divide por las de dentro de rango.
+ */
+void histograma_conteo(const histograma *h, conteo *c);
+
+/* Mínimo, máximo, media, varianza y mediana; todo en cero si está vacío */
+void histograma_resumir(const histograma *h, resumen_notas *r);
+
+/*
+ * Percentil p (0..100) por rango más cercano: la menor nota k tal que al menos
+ * el p% de las notas son <= k. -1 si el histograma está vacío.
+ */
+int histograma_percentil(const histograma *h, double p);
+
+/*
+ * Lee una lista de cortes como "18,28" (enteros crecientes en 1..MAX_NOTA) en
+ * cortes, que debe tener espacio para MAX_NOTA valores.
+ * Retorna la cantidad leída o -1 si la lista es inválida.
+ */
+int leer_cortes(const char *texto, int *cortes);
+
+/*
+ * Imprime el resumen, los percentiles y cuántas notas caen en cada tramo
+ * [0, c1), [c1, c2), ..., [cn, MAX_NOTA] definido por los cortes.
+ */
+void histograma_imprimir(const histograma *h, const int *cortes, int n_cortes);
+
+#endif
@@ -0,0 +1,419 @@
+#include "instantanea.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archivo.h"
+
+_Static_assert(sizeof(cabecera_instantanea) == 128, "la cabecera debe medir 128 bytes");
+
+#define HUELLA_BUFER (1L << 20)   // Bytes por lectura al calcular la huella (múltiplo de 8)
+
+/* Término de la palabra i (los bytes de notas [8 i, 8 i + 8)) en la huella: el finalizador de splitmix64 */
+static inline uint64_t mezclar(uint64_t i, uint64_t palabra)
+{
+    uint64_t x = palabra ^ (i * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* Lee de fd bytes bytes de notas desde el byte desde de las notas; 0 o -1 (con errno) */
+static int leer_notas(int fd, void *destino, size_t bytes, uint64_t desde)
+{
+    size_t leidos = 0;
+    while (leidos < bytes) {
+        ssize_t n = pread(fd, (char *)destino + leidos, bytes - leidos,
+                          (off_t)(sizeof(cabecera_notas) + desde + leidos));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) { if (n == 0) errno = EIO; return -1; }
+        leidos += (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Extiende la huella (*h, *cola) de las notas [0, desde) de fd a [0, hasta):
+ * vuelve a leer la palabra que quedó incompleta, suma las palabras completas
+ * desde ahí y deja en *cola los bytes que sobran. 0 o -1 (con errno).
+ */
+static int huella_extender(int fd, long desde, long hasta, uint64_t *h, uint64_t *cola)
+{
+    uint64_t fin = (uint64_t)hasta * sizeof(nota_t);
+    uint64_t palabra = (uint64_t)desde * sizeof(nota_t) / 8;
+    unsigned char *bufer = malloc(HUELLA_BUFER);
+    if (!bufer) return -1;
+    int ok = 1;
+    *cola = 0;
+    while (ok && 8 * palabra < fin) {
+        size_t bytes = fin - 8 * palabra < HUELLA_BUFER ? (size_t)(fin - 8 * palabra) : HUELLA_BUFER;
+        if (leer_notas(fd, bufer, bytes, 8 * palabra) != 0) { ok = 0; break; }
+        size_t completas = bytes / 8;
+        for (size_t k = 0; k < completas; ++k) {
+            uint64_t w;
+            memcpy(&w, bufer + 8 * k, sizeof(w));
+            *h += mezclar(palabra + k, w);
+        }
+        palabra += completas;
+        if (bytes % 8) {   // Solo en la última lectura
+            memcpy(cola, bufer + 8 * completas, bytes % 8);
+            break;
+        }
+    }
+    free(bufer);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Suma a la huella (*h, *cola) de las notas [0, cantidad) de fd las correcciones
+ * c (ordenadas por posición): por cada palabra que tocan, sale el término de
+ * la palabra del archivo y entra el de la corregida. 0 o -1 (con errno).
+ */
+static int huella_corregir(int fd, long cantidad, const correcciones *c, uint64_t *h, uint64_t *cola)
+{
+    uint64_t completas = (uint64_t)cantidad * sizeof(nota_t) / 8;
+    for (long i = 0; i < c->n;) {
+        uint64_t palabra = (uint64_t)c->lista[i].posicion * sizeof(nota_t) / 8, antes = 0, despues;
+        if (palabra < completas) {
+            if (leer_notas(fd, &antes, sizeof(antes), 8 * palabra) != 0) return -1;
+        } else {
+            antes = *cola;
+        }
+        despues = antes;
+        for (; i < c->n && (uint64_t)c->lista[i].posicion * sizeof(nota_t) / 8 == palabra; ++i)
+            memcpy((char *)&despues + (uint64_t)c->lista[i].posicion * sizeof(nota_t) - 8 * palabra,
+                   &c->lista[i].nueva, sizeof(nota_t));
+        if (palabra < completas) *h += mezclar(palabra, despues) - mezclar(palabra, antes);
+        else *cola = despues;
+    }
+    return 0;
+}
+
+/* 1 si el archivo de st es el mismo y no cambió desde que se guardó cab */
+static int sin_cambios(const struct stat *st, const cabecera_instantanea *cab)
+{
+    return (uint64_t)st->st_dev == cab->dispositivo && (uint64_t)st->st_ino == cab->inodo
+           && (uint64_t)st->st_size == cab->bytes && (int64_t)st->st_mtim.tv_sec == cab->modificado_s
+           && (int64_t)st->st_mtim.tv_nsec == cab->modificado_ns;
+}
+
+/* Comprueba que las notas cubiertas de datos sean las de cab; 0 o -1 (con el motivo en stderr) */
+static int comparar_archivo(const char *ruta, const char *datos, const cabecera_instantanea *cab)
+{
+    struct stat st;
+    int fd = open(datos, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(datos);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (sin_cambios(&st, cab)) { close(fd); return 0; }
+    // El archivo cambió desde que se guardó (por ejemplo, se le agregaron notas): se relee lo cubierto
+    uint64_t h = 0, cola = 0;
+    int ok = huella_extender(fd, 0, (long)cab->cantidad, &h, &cola) == 0;
+    if (!ok) perror(datos);
+    close(fd);
+    if (ok && (h != cab->huella || cola != cab->cola)) {
+        fprintf(stderr, "%s: instantánea de otro archivo (las notas cubiertas no coinciden con %s)\n", ruta, datos);
+        ok = 0;
+    }
+    return ok ? 0 : -1;
+}
+
+/*
+ * Lleva la huella de s a todas las notas cubiertas de datos, con las
+ * correcciones c (o NULL) encima, y anota la identidad del archivo. 0 o -1 (con errno).
+ */
+static int huella_actualizar(const char *datos, instantanea *s, const correcciones *c)
+{
+    cabecera_instantanea *cab = &s->cab;
+    long cantidad = (long)cab->cantidad;
+    struct stat st;
+    int fd = open(datos, O_RDONLY);
+    if (fd < 0) return -1;
+    int ok = huella_extender(fd, s->con_huella, cantidad, &cab->huella, &cab->cola) == 0
+             && (!c || huella_corregir(fd, cantidad, c, &cab->huella, &cab->cola) == 0)
+             && fstat(fd, &st) == 0;
+    int e = errno;
+    close(fd);
+    if (!ok) { errno = e; return -1; }
+    s->con_huella = cantidad;
+    cab->dispositivo   = (uint64_t)st.st_dev;
+    cab->inodo         = (uint64_t)st.st_ino;
+    cab->bytes         = (uint64_t)st.st_size;
+    cab->modificado_s  = (int64_t)st.st_mtim.tv_sec;
+    cab->modificado_ns = (int64_t)st.st_mtim.tv_nsec;
+    return 0;
+}
+
+int instantanea_leer(const char *ruta, instantanea *s, long total, uint64_t semilla, const char *datos)
+{
+    int de_archivo = datos != NULL;
+    memset(s, 0, sizeof(*s));
+    FILE *f = fopen(ruta, "rb");
+    if (!f) {
+        if (errno == ENOENT) return 0;
+        perror(ruta);
+        return -1;
+    }
+    cabecera_instantanea *cab = &s->cab;
+    if (fread(cab, sizeof(*cab), 1, f) != 1 || memcmp(cab->magia, INSTANTANEA_MAGIA, sizeof(cab->magia)) != 0
+        || cab->version != INSTANTANEA_VERSION) {
+        fprintf(stderr, "%s: no es una instantánea (versión %d)\n", ruta, INSTANTANEA_VERSION);
+        goto error;
+    }
+    if (cab->bytes_por_nota != sizeof(nota_t)) {
+        fprintf(stderr, "%s: instantánea de notas de %u byte(s), este programa usa %zu\n",
+                ruta, cab->bytes_por_nota, sizeof(nota_t));
+        goto error;
+    }
+    if ((int)cab->de_archivo != de_archivo) {
+        fprintf(stderr, "%s: instantánea de notas %s\n", ruta, cab->de_archivo ? "de un archivo (use --archivo)" : "generadas (sin --archivo)");
+        goto error;
+    }
+    if (cab->semilla != semilla) {
+        if (de_archivo)
+            fprintf(stderr, "%s: instantánea de otro archivo (semilla %llu)\n", ruta, (unsigned long long)cab->semilla);
+        else
+            fprintf(stderr, "%s: instantánea de las notas generadas con semilla %llu (indique --semilla %llu)\n",
+                    ruta, (unsigned long long)cab->semilla, (unsigned long long)cab->semilla);
+        goto error;
+    }
+    if (cab->cantidad > (uint64_t)total) {
+        fprintf(stderr, "%s: cubre %llu notas y solo hay %ld (las notas solo se agregan al final)\n",
+                ruta, (unsigned long long)cab->cantidad, total);
+        goto error;
+    }
+    if (fread(&s->total, sizeof(histograma), 1, f) != 1) {
+        fprintf(stderr, "%s: truncada (falta el histograma)\n", ruta);
+        goto error;
+    }
+    if (de_archivo && comparar_archivo(ruta, datos, cab) != 0) goto error;
+    s->con_huella = (long)cab->cantidad;
+    fclose(f);
+    return 1;
+
+error:
+    fclose(f);
+    return -1;
+}
+
+void instantanea_crear(instantanea *s, uint64_t semilla, int de_archivo)
+{
+    memset(s, 0, sizeof(*s));
+    memcpy(s->cab.magia, INSTANTANEA_MAGIA, sizeof(s->cab.magia));
+    s->cab.version = INSTANTANEA_VERSION;
+    s->cab.bytes_por_nota = sizeof(nota_t);
+    s->cab.semilla = semilla;
+    s->cab.de_archivo = (uint32_t)de_archivo;
+    s->nueva = 1;
+}
+
+void instantanea_plegar(instantanea *s, const histograma *delta)
+{
+    histograma_sumar(&s->total, delta);
+}
+
+void instantanea_avanzar(instantanea *s, long hasta)
+{
+    s->cab.cantidad = (uint64_t)hasta;
+    if (!s->nueva) s->cab.actualizaciones++;
+}
+
+/* Cuenta la nota en h con signo (+1 entra, -1 sale); las fuera de rango van aparte */
+static void contar(histograma *h, nota_t nota, int signo)
+{
+    if ((unsigned)nota <= MAX_NOTA) h->cuenta[nota] += signo;
+    else h->fuera += signo;
+}
+
+/* Lee las correcciones de ruta en un arreglo nuevo; *n recibe cuántas son. NULL si hay un error */
+static correccion *leer_correcciones(const char *ruta, long total, long *n)
+{
+    FILE *f = fopen(ruta, "r");
+    if (!f) { perror(ruta); return NULL; }
+    long capacidad = 64, linea_n = 0;
+    correccion *lista = malloc(sizeof(correccion) * capacidad);
+    char linea[128];
+    *n = 0;
+    while (lista && fgets(linea, sizeof(linea), f)) {
+        ++linea_n;
+        char *p = linea + strspn(linea, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+        long posicion, nota;
+        char resto;
+        if (sscanf(p, "%ld %ld %c", &posicion, &nota, &resto) != 2 || posicion < 0 || posicion >= total
+            || nota < 0 || nota > MAX_NOTA) {
+            fprintf(stderr, "%s:%ld: corrección inválida (POSICION entre 0 y %ld, NOTA entre 0 y %d)\n",
+                    ruta, linea_n, total - 1, MAX_NOTA);
+            free(lista);
+            fclose(f);
+            return NULL;
+        }
+        if (*n == capacidad) {
+            correccion *mas = realloc(lista, sizeof(correccion) * (capacidad *= 2));
+            if (!mas) { free(lista); lista = NULL; break; }
+            lista = mas;
+        }
+        lista[*n] = (correccion){ .posicion = posicion, .orden = *n, .nueva = (nota_t)nota };
+        ++*n;
+    }
+    if (!lista) perror("malloc");
+    fclose(f);
+    return lista;
+}
+
+/* Por posición y, dentro de la misma, por orden en la ruta */
+static int comparar_correcciones(const void *a, const void *b)
+{
+    const correccion *x = a, *y = b;
+    if (x->posicion != y->posicion) return (x->posicion > y->posicion) - (x->posicion < y->posicion);
+    return (x->orden > y->orden) - (x->orden < y->orden);
+}
+
+int instantanea_corregir(instantanea *s, const char *ruta, const char *datos, correcciones *c)
+{
+    memset(c, 0, sizeof(*c));
+    long n;
+    correccion *lista = leer_correcciones(ruta, (long)s->cab.cantidad, &n);
+    if (!lista) return -1;
+    // Una sola corrección por posición (la última): la anterior de cada una es la del archivo
+    qsort(lista, (size_t)n, sizeof(correccion), comparar_correcciones);
+    long unicas = 0;
+    for (long i = 0; i < n; ++i) {
+        if (unicas > 0 && lista[unicas - 1].posicion == lista[i].posicion) lista[unicas - 1] = lista[i];
+        else lista[unicas++] = lista[i];
+    }
+    int fd = open(datos, O_RDONLY);
+    if (fd < 0) { perror(datos); free(lista); return -1; }
+    for (long i = 0; i < unicas; ++i) {
+        off_t lugar = (off_t)sizeof(cabecera_notas) + (off_t)lista[i].posicion * (off_t)sizeof(nota_t);
+        if (pread(fd, &lista[i].anterior, sizeof(nota_t), lugar) != (ssize_t)sizeof(nota_t)) {
+            perror(datos);
+            close(fd);
+            free(lista);
+            return -1;
+        }
+    }
+    close(fd);
+    *c = (correcciones){ .lista = lista, .n = unicas };
+    correcciones_aplicar(c, &s->total);
+    s->cab.correcciones += (uint64_t)unicas;
+    return 0;
+}
+
+void correcciones_aplicar(const correcciones *c, histograma *h)
+{
+    for (long i = 0; i < c->n; ++i) {
+        contar(h, c->lista[i].anterior, -1);
+        contar(h, c->lista[i].nueva, +1);
+    }
+}
+
+int instantanea_escribir_correcciones(instantanea *s, const char *ruta, const correcciones *c, const char *datos)
+{
+    int fd = open(datos, O_WRONLY);
+    long escritas = 0;
+    if (fd >= 0) {
+        for (; escritas < c->n; ++escritas) {
+            off_t lugar = (off_t)sizeof(cabecera_notas) + (off_t)c->lista[escritas].posicion * (off_t)sizeof(nota_t);
+            if (pwrite(fd, &c->lista[escritas].nueva, sizeof(nota_t), lugar) != (ssize_t)sizeof(nota_t)) break;
+        }
+    }
+    int ok = fd >= 0 && escritas == c->n && fsync(fd) == 0;
+    if (!ok) perror(datos);
+    if (fd >= 0) close(fd);
+    if (escritas < c->n) {
+        // Las que no llegaron al archivo salen de la instantánea ya guardada
+        for (long i = escritas; i < c->n; ++i) {
+            contar(&s->total, c->lista[i].nueva, -1);
+            contar(&s->total, c->lista[i].anterior, +1);
+        }
+        s->cab.correcciones -= (uint64_t)(c->n - escritas);
+        s->cab.huella = s->cab.cola = 0;   // Se vuelve a calcular sobre lo que quedó en el archivo
+        s->con_huella = 0;
+        if (instantanea_guardar(ruta, s, datos, NULL) != 0) perror(ruta);
+        fprintf(stderr, "%s: se escribieron %ld de %ld correcciones; la instantánea cubre solo esas\n",
+                datos, escritas, c->n);
+    } else if (ok && instantanea_guardar(ruta, s, datos, NULL) != 0) {
+        // Escribir cambió la fecha del archivo: sin la nueva, la próxima corrida relee todo lo cubierto
+        perror(ruta);
+    }
+    return ok ? 0 : -1;
+}
+
+void correcciones_liberar(correcciones *c)
+{
+    free(c->lista);
+    c->lista = NULL;
+    c->n = 0;
+}
+
+void instantanea_total(const instantanea *s, histograma *h)
+{
+    *h = s->total;
+}
+
+int instantanea_guardar(const char *ruta, instantanea *s, const char *datos, const correcciones *c)
+{
+    if (datos && huella_actualizar(datos, s, c) != 0) return -1;
+    char temporal[4096];
+    if (snprintf(temporal, sizeof(temporal), "%s.tmp", ruta) >= (int)sizeof(temporal)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    FILE *f = fopen(temporal, "wb");
+    if (!f) return -1;
+    int ok = fwrite(&s->cab, sizeof(s->cab), 1, f) == 1
+             && fwrite(&s->total, sizeof(histograma), 1, f) == 1
+             && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(temporal, ruta) == 0) return 0;
+    int e = errno ? errno : EIO;
+    unlink(temporal);
+    errno = e;
+    return -1;
+}
+
+void instantanea_imprimir(const instantanea *s, const char *ruta, long base, long corregidas, double segundos)
+{
+    long cantidad = (long)s->cab.cantidad;
+    printf("\n=== Instantánea (%s) ===\n", ruta);
+    if (s->nueva)
+        printf("Creada: %ld notas\n", cantidad);
+    else
+        printf("Notas: %ld + %ld agregadas = %ld | Correcciones: %ld (%llu en total)\n",
+               base, cantidad - base, cantidad, corregidas, (unsigned long long)s->cab.correcciones);
+    printf("Actualizaciones: %llu | Delta procesado en %.6f segundos\n",
+           (unsigned long long)s->cab.actualizaciones, segundos);
+}
+
+int instantanea_verificar(const histograma *plegado, const histograma *completo,
+                          double incremental, double recalculo)
+{
+    if (memcmp(plegado, completo, sizeof(*plegado)) == 0) {
+        printf("Verificación: el plegado incremental coincide con el recálculo completo "
+               "(%.6f s contra %.6f s)\n", incremental, recalculo);
+        return 0;
+    }
+    conteo a = {0}, b = {0};
+    histograma_conteo(plegado, &a);
+    histograma_conteo(completo, &b);
+    printf("Verificación: DIFERENCIAS entre el plegado incremental y el recálculo completo\n");
+    printf("  Suma: %lld / %lld\n", a.suma, b.suma);
+    printf("  Reprobados: %lld / %lld\n", a.reprobados, b.reprobados);
+    printf("  Aprobados (18-27.99): %lld / %lld\n", a.aprobado_bajo, b.aprobado_bajo);
+    printf("  Aprobados (28-40): %lld / %lld\n", a.aprobado_alto, b.aprobado_alto);
+    printf("  Fuera de rango: %lld / %lld\n", plegado->fuera, completo->fuera);
+    for (int k = 0; k < N_CLASES; ++k)
+        if (plegado->cuenta[k] != completo->cuenta[k])
+            printf("  Nota %d: %lld / %lld\n", k, plegado->cuenta[k], completo->cuenta[k]);
+    return -1;
+}
@@ -0,0 +1,140 @@
+#ifndef INSTANTANEA_H
+#define INSTANTANEA_H
+
+#include <stdint.h>
+
+#include "comun.h"
+#include "histograma.h"
+
+#define INSTANTANEA_MAGIA   "NOTASNAP"   // Primeros 8 bytes de toda instantánea
+#define INSTANTANEA_VERSION 4
+
+/*
+ * Cabecera de 128 bytes de una instantánea. Le sigue el histograma de las notas
+ * [0, cantidad), del que salen la suma y las categorías exactas sin volver a
+ * leerlas. Es uno solo: los trabajadores toman bloques de cualquier posición,
+ * así que un histograma por trabajador no correspondería a un tramo de notas.
+ *
+ * Con archivo, la huella cubre todas las notas cubiertas: es la suma de una
+ * mezcla de cada palabra de 8 bytes con su posición, así que agregar notas
+ * solo suma las palabras nuevas y una corrección solo cambia el término de su
+ * palabra (no hace falta releer lo ya cubierto). Los bytes que no completan
+ * una palabra van tal cual en cola.
+ */
+typedef struct {
+    char magia[8];            // INSTANTANEA_MAGIA
+    uint32_t version;         // INSTANTANEA_VERSION
+    uint32_t bytes_por_nota;  // sizeof(nota_t) de quien la escribió
+    uint64_t cantidad;        // Notas cubiertas: posiciones [0, cantidad)
+    uint64_t semilla;         // Semilla de las notas generadas o la de la cabecera del archivo
+    uint64_t correcciones;    // Correcciones aplicadas desde que se creó
+    uint64_t actualizaciones; // Corridas incrementales plegadas desde que se creó
+    uint64_t huella;          // Con archivo: suma de las palabras completas de lo cubierto, mezcladas con su posición
+    uint64_t cola;            // Con archivo: los bytes cubiertos tras la última palabra completa (el resto en cero)
+    uint64_t dispositivo;     // st_dev, st_ino, st_size y st_mtim del archivo al guardar: si no cambiaron,
+    uint64_t inodo;           // la huella no se vuelve a calcular al leer la instantánea
+    uint64_t bytes;
+    int64_t modificado_s;
+    int64_t modificado_ns;
+    uint32_t de_archivo;      // 1: las notas vienen de un archivo (admite correcciones)
+    uint8_t reservado[20];    // Relleno hasta 128 bytes
+} cabecera_instantanea;
+
+/* Una corrección: la posición, la nota que tenía el archivo y la nueva */
+typedef struct {
+    long posicion;
+    long orden;               // Línea de la ruta (la última gana si una posición se repite)
+    nota_t anterior, nueva;
+} correccion;
+
+/* Correcciones preparadas: ya contadas en la instantánea, todavía sin escribir en el archivo */
+typedef struct {
+    correccion *lista;        // Ordenadas por posición, una por posición
+    long n;
+} correcciones;
+
+/* Instantánea en memoria: la cabecera y el histograma de lo cubierto */
+typedef struct {
+    cabecera_instantanea cab;
+    histograma total;
+    int nueva;                // 1: creada en esta corrida (no la leyó instantanea_leer)
+    long con_huella;          // Notas [0, con_huella) que ya cubren cab.huella y cab.cola
+} instantanea;
+
+/*
+ * Lee la instantánea de ruta y comprueba que describe las mismas notas que se
+ * van a procesar: mismo tamaño de nota, mismo origen (el archivo datos, o NULL
+ * si son generadas), misma semilla y no más notas que total (solo se agregan al
+ * final). Con archivo compara además las notas cubiertas (los archivos de notas
+ * reales tienen todos semilla 0): si el archivo tiene el mismo dispositivo,
+ * inodo, tamaño y fecha de modificación que al guardar, no se leen; si cambió
+ * (por ejemplo, se le agregaron notas) se recalcula la huella de todas las
+ * cubiertas, una pasada sobre ellas.
+ * Retorna 1 si la leyó, 0 si ruta no existe (hay que crearla con una corrida
+ * completa) o -1 si no sirve (con el motivo en stderr).
+ */
+int instantanea_leer(const char *ruta, instantanea *s, long total, uint64_t semilla, const char *datos);
+
+/* Prepara una instantánea vacía */
+void instantanea_crear(instantanea *s, uint64_t semilla, int de_archivo);
+
+/* Suma a la instantánea el histograma de lo que procesó un trabajador en esta corrida */
+void instantanea_plegar(instantanea *s, const histograma *delta);
+
+/* Pasa a cubrir las notas [0, hasta); si no es nueva, cuenta una actualización más */
+void instantanea_avanzar(instantanea *s, long hasta);
+
+/*
+ * Prepara las correcciones de ruta (líneas "POSICION NOTA"; se ignoran las
+ * vacías y las que empiezan con #) y las cuenta en la instantánea: la nota
+ * anterior se lee del archivo datos, sale del histograma y entra la nueva. El
+ * archivo todavía no se modifica: eso lo hace instantanea_escribir_correcciones()
+ * después de verificar y guardar la instantánea, así una verificación fallida
+ * no deja el archivo corregido con la instantánea vieja. Las posiciones se
+ * validan contra lo que cubre la instantánea (se corrige después de plegar).
+ * Retorna 0 o -1 (con el motivo en stderr).
+ */
+int instantanea_corregir(instantanea *s, const char *ruta, const char *datos, correcciones *c);
+
+/* Aplica las correcciones a h (un recálculo sobre el archivo todavía sin corregir) */
+void correcciones_aplicar(const correcciones *c, histograma *h);
+
+/*
+ * Escribe las correcciones en el archivo datos (pwrite y fsync) y vuelve a
+ * guardar la instantánea en ruta con la nueva identidad del archivo. Si una
+ * escritura falla, las que faltan se descuentan de la instantánea y su huella
+ * se recalcula sobre el archivo, para que siga describiéndolo.
+ * Retorna 0 o -1 (con el motivo en stderr).
+ */
+int instantanea_escribir_correcciones(instantanea *s, const char *ruta, const correcciones *c, const char *datos);
+
+void correcciones_liberar(correcciones *c);
+
+/* Histograma de todas las notas cubiertas */
+void instantanea_total(const instantanea *s, histograma *h);
+
+/*
+ * Escribe la instantánea en un archivo temporal junto a ruta y lo renombra,
+ * así una corrida interrumpida deja la instantánea anterior intacta. Con el
+ * archivo datos (NULL si son generadas) extiende antes la huella a las notas
+ * agregadas, le suma las correcciones c (o NULL) como si ya estuvieran escritas
+ * y anota la identidad actual del archivo.
+ * Retorna 0 o -1 (con errno).
+ */
+int instantanea_guardar(const char *ruta, instantanea *s, const char *datos, const correcciones *c);
+
+/*
+ * Imprime qué cubre la instantánea después de esta corrida: base notas ya
+ * cubiertas antes (0 si se creó ahora), las agregadas y las corregidas.
+ */
+void instantanea_imprimir(const instantanea *s, const char *ruta, long base, long corregidas, double segundos);
+
+/*
+ * Compara el histograma plegado con el de un recálculo completo e imprime el
+ * resultado (con las diferencias por categoría si las hay).
+ * Retorna 0 si coinciden o -1 si no.
+ */
+int instantanea_verificar(const histograma *plegado, const histograma *completo,
+                          double incremental, double recalculo);
+
+#endif
@@ -0,0 +1,84 @@
+#define _GNU_SOURCE
+#include "memoria.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PAGINA_ENORME (2UL << 20)   // Página enorme de 2 MB (x86-64)
+
+/*
+ * Mapea fd completo en r; retorna 0 o -1.
+ */
+static int mapear(region *r, size_t bytes)
+{
+    r->base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+    if (r->base == MAP_FAILED) { r->base = NULL; return -1; }
+    r->bytes = bytes;
+    return 0;
+}
+
+int region_crear(region *r, const char *nombre, size_t bytes, int enormes)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+#ifdef MFD_HUGETLB
+    if (enormes) {
+        // hugetlbfs exige que el tamaño sea múltiplo de la página enorme
+        size_t redondeado = (bytes + PAGINA_ENORME - 1) & ~(PAGINA_ENORME - 1);
+        r->fd = memfd_create(nombre + 1, MFD_HUGETLB);
+        if (r->fd >= 0 && ftruncate(r->fd, redondeado) == 0 && mapear(r, redondeado) == 0) {
+            r->enorme = 1;
+            snprintf(r->ruta, sizeof(r->ruta), "/proc/%d/fd/%d", (int)getpid(), r->fd);
+            return 0;
+        }
+        if (r->fd >= 0) close(r->fd);   // Sin páginas enormes reservadas: se usa shm_open
+        r->fd = -1;
+    }
+#endif
+    r->fd = shm_open(nombre, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (r->fd < 0) return -1;
+    r->nombrada = 1;
+    snprintf(r->ruta, sizeof(r->ruta), "%s", nombre);
+    if (ftruncate(r->fd, bytes) != 0 || mapear(r, bytes) != 0) {
+        int e = errno;
+        region_liberar(r, 1);
+        errno = e;
+        return -1;
+    }
+#ifdef MADV_HUGEPAGE
+    if (enormes)
+        madvise(r->base, r->bytes, MADV_HUGEPAGE); // THP para shmem, si el sistema lo permite
+#endif
+    return 0;
+}
+
+int region_adjuntar(region *r, const char *ruta)
+{
+    memset(r, 0, sizeof(*r));
+    snprintf(r->ruta, sizeof(r->ruta), "%s", ruta);
+    // Las regiones memfd se abren a través de /proc del creador
+    r->fd = strncmp(ruta, "/proc/", 6) == 0 ? open(ruta, O_RDWR) : shm_open(ruta, O_RDWR, 0);
+    if (r->fd < 0) return -1;
+    struct stat st;
+    if (fstat(r->fd, &st) != 0 || mapear(r, (size_t)st.st_size) != 0) {
+        int e = errno;
+        close(r->fd);
+        errno = e;
+        return -1;
+    }
+    return 0;
+}
+
+void region_liberar(region *r, int eliminar)
+{
+    if (r->base) munmap(r->base, r->bytes);
+    if (r->fd >= 0) close(r->fd);
+    if (eliminar && r->nombrada) shm_unlink(r->ruta);
+    r->base = NULL;
+    r->fd = -1;
+}
@@ -0,0 +1,36 @@
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <stddef.h>
+
+/* Región de memoria compartida con nombre a la que otros procesos pueden adjuntarse */
+typedef struct {
+    void *base;           // Dirección del mapeo
+    size_t bytes;         // Tamaño mapeado (redondeado a la página usada)
+    int fd;               // Descriptor del objeto de memoria
+    int enorme;           // 1 si está respaldada por páginas enormes (hugetlbfs)
+    int nombrada;         // 1 si se creó con shm_open (hay que hacer shm_unlink)
+    char ruta[64];        // Nombre para adjuntarse: "/nombre" (shm) o "/proc/PID/fd/N" (memfd)
+} region;
+
+/*
+ * Crea una región compartida de al menos bytes bytes.
+ * nombre: nombre POSIX ("/algo") usado con shm_open.
+ * enormes: 1 para intentar páginas enormes: primero memfd con MFD_HUGETLB y,
+ * si no hay páginas reservadas, shm_open con madvise(MADV_HUGEPAGE).
+ * Retorna 0 si tuvo éxito o -1 (con errno) si falló.
+ */
+int region_crear(region *r, const char *nombre, size_t bytes, int enormes);
+
+/*
+ * Se adjunta a una región creada por otro proceso a partir de su ruta.
+ * Retorna 0 si tuvo éxito o -1 (con errno) si falló.
+ */
+int region_adjuntar(region *r, const char *ruta);
+
+/*
+ * Desmapea la región. eliminar: 1 en el creador para borrar el objeto.
+ */
+void region_liberar(region *r, int eliminar);
+
+#endif
@@ -0,0 +1,349 @@
+#define _GNU_SOURCE   /* mkstemps */
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "comun.h"
+#include "agregacion.h"
+#include "archivo.h"
+#include "clasificacion.h"
+#include "estadistica.h"
+#include "generador.h"
+#include "histograma.h"
+#include "registro.h"
+
+/*
+ * Microbenchmarks de las tres piezas que comparten los motores, cada una
+ * aislada en un solo hilo: el kernel de clasificación (y el histograma) sobre
+ * tamaños que van desde la L1 hasta más allá de la RAM, la reducción de los
+ * resultados de n trabajadores y la escritura del registro de una corrida.
+ */
+
+#define BYTES_POR_MEDICION (64L << 20) // Cada medición recorre al menos 64 MiB (varias pasadas si cabe en caché)
+#define MAX_KERNELS 5
+#define VENTANA_ARCHIVO (64L << 20)    // Bytes por ventana al recorrer el archivo
+
+static const char *todos_kernels[] = { "ramas", "escalar", "sse4", "avx2" };
+
+/* Segundos desde una marca de CLOCK_MONOTONIC */
+static double desde(struct timespec t0)
+{
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return segundos_entre(t0, t1);
+}
+
+/* Tamaño de caché de sysconf o el de respaldo si el sistema no lo informa */
+static long cache(int nombre, long respaldo)
+{
+    long v = sysconf(nombre);
+    return v > 0 ? v : respaldo;
+}
+
+/* Nivel de la jerarquía donde cabe un arreglo de bytes bytes */
+static const char *nivel(long bytes)
+{
+    if (bytes <= cache(_SC_LEVEL1_DCACHE_SIZE, 32L << 10)) return "L1";
+    if (bytes <= cache(_SC_LEVEL2_CACHE_SIZE, 1L << 20)) return "L2";
+    if (bytes <= cache(_SC_LEVEL3_CACHE_SIZE, 32L << 20)) return "L3";
+    return "RAM";
+}
+
+/* Tamaño legible: 4 KiB, 2 MiB, 1 GiB */
+static const char *legible(long bytes, char *buf, size_t n)
+{
+    if (bytes >= (1L << 30)) snprintf(buf, n, "%ld GiB", bytes >> 30);
+    else if (bytes >= (1L << 20)) snprintf(buf, n, "%ld MiB", bytes >> 20);
+    else snprintf(buf, n, "%ld KiB", bytes >> 10);
+    return buf;
+}
+
+/*
+ * GB/s medianos de recorrer notas[0 .. cantidad) con el kernel seleccionado
+ * (o con el histograma si hist) en repeticiones mediciones. Deja en c el
+ * conteo de una pasada, para comparar los kernels entre sí.
+ */
+static double medir_kernel(const nota_t *notas, long cantidad, int hist, int repeticiones, conteo *c)
+{
+    long pasadas = BYTES_POR_MEDICION / (cantidad * (long)sizeof(nota_t));
+    if (pasadas < 1) pasadas = 1;
+    double *muestras = malloc(sizeof(double) * repeticiones);
+    if (!muestras) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int r = -1; r < repeticiones; ++r) {   // La primera deja los datos en caché y no se cuenta
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (long p = 0; p < pasadas; ++p) {
+            conteo local = {0};
+            if (hist) {
+                histograma h = {0};
+                histogramar(notas, cantidad, &h);
+                histograma_conteo(&h, &local);
+            } else {
+                clasificar(notas, cantidad, &local);
+            }
+            *c = local;
+        }
+        if (r >= 0) muestras[r] = gbps(cantidad * pasadas, desde(t0));
+    }
+    resumen_muestras res;
+    resumir(muestras, repeticiones, &res);
+    free(muestras);
+    return res.mediana;
+}
+
+/*
+ * Clasificación desde L1 hasta maximo bytes: una fila por tamaño (duplicándolo)
+ * con los GB/s de cada kernel y del histograma. Verifica que todos coincidan.
+ */
+static int medir_kernels(const char **kernels, int n_kernels, long maximo, int repeticiones)
+{
+    long total = maximo / (long)sizeof(nota_t);
+    nota_t *notas = malloc(sizeof(nota_t) * total);
+    if (!notas) { perror("malloc"); return -1; }
+    generar_notas(notas, 0, total, 7);
+
+    printf("\n=== Kernel de clasificación (GB/s, mediana de %d) ===\n", repeticiones);
+    printf("%-9s %-5s", "Tamaño", "Nivel");
+    for (int k = 0; k < n_kernels; ++k) printf(" | %9s", kernels[k]);
+    printf(" | %10s\n", "histograma");
+    int error = 0;
+    for (long bytes = 4L << 10; bytes <= maximo; bytes *= 2) {
+        long cantidad = bytes / (long)sizeof(nota_t);
+        char buf[32];
+        conteo referencia, c;
+        printf("%-9s %-5s", legible(bytes, buf, sizeof(buf)), nivel(bytes));
+        for (int k = 0; k < n_kernels; ++k) {
+            seleccionar_kernel(kernels[k]);
+            printf(" | %9.2f", medir_kernel(notas, cantidad, 0, repeticiones, &c));
+            if (k == 0) referencia = c;
+            else if (memcmp(&c, &referencia, sizeof(c)) != 0) error = 1;
+        }
+        printf(" | %10.2f\n", medir_kernel(notas, cantidad, 1, repeticiones, &c));
+        if (memcmp(&c, &referencia, sizeof(c)) != 0) error = 1;
+        fflush(stdout);
+    }
+    if (error) fprintf(stderr, "❌  Los kernels no dieron el mismo conteo\n");
+    free(notas);
+    return error ? -1 : 0;
+}
+
+/*
+ * Clasificación sobre un archivo de notas leído por ventanas, con la caché de
+ * páginas del archivo vaciada antes de cada pasada: si el archivo supera la RAM
+ * (o tras vaciarla) cada pasada lee del disco.
+ */
+static int medir_archivo(const char *ruta, const char *kernel, int repeticiones)
+{
+    archivo_notas a;
+    if (archivo_abrir(&a, ruta, 0) != 0) return -1;
+    seleccionar_kernel(kernel);
+    double *muestras = malloc(sizeof(double) * repeticiones);
+    if (!muestras) { perror("malloc"); return -1; }
+    long por_ventana = VENTANA_ARCHIVO / (long)sizeof(nota_t);
+    for (int r = 0; r < repeticiones; ++r) {
+        posix_fadvise(a.fd, 0, 0, POSIX_FADV_DONTNEED);
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        conteo c = {0};
+        for (long inicio = 0; inicio < a.cantidad; inicio += por_ventana) {
+            long cantidad = a.cantidad - inicio < por_ventana ? a.cantidad - inicio : por_ventana;
+            ventana v;
+            const nota_t *datos = archivo_ventana(&a, inicio, cantidad, &v);
+            if (!datos) { perror("mmap"); free(muestras); archivo_cerrar(&a); return -1; }
+            clasificar(datos, cantidad, &c);
+            ventana_liberar(&v);
+        }
+        muestras[r] = gbps(a.cantidad, desde(t0));
+    }
+    resumen_muestras res;
+    resumir(muestras, repeticiones, &res);
+    char buf[32];
+    long ram = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    printf("\n=== Archivo %s (%s, %s la RAM, caché de páginas vaciada) ===\n", ruta,
+           legible(a.cantidad * (long)sizeof(nota_t), buf, sizeof(buf)),
+           a.cantidad * (long)sizeof(nota_t) > ram ? "mayor que" : "menor que");
+    printf("Kernel %s: mediana %.2f GB/s | mín %.2f | máx %.2f\n", kernel, res.mediana, res.minimo, res.maximo);
+    free(muestras);
+    archivo_cerrar(&a);
+    return 0;
+}
+
+/*
+ * Reducción de n trabajadores: lo que cuesta que cada uno sume su conteo con
+ * cada modo del agregador (sin competencia: mide el camino, no la contención)
+ * más la reducción final, y mezclar n histogramas.
+ */
+static void medir_reduccion(int repeticiones)
+{
+    static const int trabajadores[] = { 1, 4, 16, 64, 256 };
+    printf("\n=== Reducción de n trabajadores (ns en total, mediana de %d) ===\n", repeticiones);
+    printf("%-12s | %10s | %10s | %10s | %10s\n", "Trabajadores", "mutex", "atomico", "ranuras", "histogramas");
+    double *muestras = malloc(sizeof(double) * repeticiones);
+    if (!muestras) { perror("malloc"); exit(EXIT_FAILURE); }
+    const int iteraciones = 1000;  // Reducciones por muestra (una sola dura pocos ns)
+    for (size_t t = 0; t < sizeof(trabajadores) / sizeof(trabajadores[0]); ++t) {
+        int n = trabajadores[t];
+        conteo c = { .suma = 20, .reprobados = 1 };
+        printf("%-12d", n);
+        for (int modo = AGREGA_MUTEX; modo <= AGREGA_RANURAS; ++modo) {
+            agregador *a = agregador_nuevo((modo_agregacion)modo, n);
+            if (!a) { perror("aligned_alloc"); exit(EXIT_FAILURE); }
+            long long totales[3];
+            for (int r = 0; r < repeticiones; ++r) {
+                struct timespec t0;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                for (int i = 0; i < iteraciones; ++i) {
+                    for (int w = 0; w < n; ++w) agregador_sumar(a, w, &c);
+                    agregador_totales(a, totales);
+                }
+                muestras[r] = 1e9 * desde(t0) / iteraciones;
+            }
+            resumen_muestras res;
+            resumir(muestras, repeticiones, &res);
+            printf(" | %10.1f", res.mediana);
+            agregador_destruir(a);
+            free(a);
+        }
+        histograma *h = calloc((size_t)n, sizeof(histograma));
+        if (!h) { perror("calloc"); exit(EXIT_FAILURE); }
+        for (int w = 0; w < n; ++w)
+            for (int k = 0; k < N_CLASES; ++k) h[w].cuenta[k] = w + k;
+        histograma total;
+        for (int r = 0; r < repeticiones; ++r) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (int i = 0; i < iteraciones; ++i) {
+                memset(&total, 0, sizeof(total));
+                for (int w = 0; w < n; ++w) histograma_sumar(&total, &h[w]);
+            }
+            muestras[r] = 1e9 * desde(t0) / iteraciones;
+        }
+        resumen_muestras res;
+        resumir(muestras, repeticiones, &res);
+        printf(" | %11.1f\n", res.mediana);
+        free(h);
+    }
+    free(muestras);
+}
+
+/*
+ * Escritura del registro: cuánto tarda registro_agregar() con n grupos en un
+ * archivo temporal, con histograma y contadores.
+ */
+static int medir_registro(int repeticiones)
+{
+    static const int grupos[] = { 1, 16, 64, 256 };
+    printf("\n=== Escritura del registro (us por corrida, mediana de %d) ===\n", repeticiones);
+    printf("%-7s | %10s | %10s\n", "Grupos", "JSON", "bytes");
+    double *muestras = malloc(sizeof(double) * repeticiones);
+    registro_grupo *g = calloc(256, sizeof(registro_grupo));
+    if (!muestras || !g) { perror("malloc"); return -1; }
+    medicion_hw hw = { .hw = { 1000000, 2000000, 100, 200, 300 }, .fallos_menores = 10 };
+    histograma hist = {0};
+    for (int k = 0; k < N_CLASES; ++k) hist.cuenta[k] = 487804 + k;
+    for (int i = 0; i < 256; ++i) {
+        g[i] = (registro_grupo){ .promedio = 20.0, .reprobados = 34000, .aprobado_bajo = 19000, .aprobado_alto = 25000,
+                                 .cantidad = 78125, .tiempo = 0.001, .bloques = 2, .cpu = i, .hw = &hw };
+        etiqueta_grupo(i, g[i].etiqueta);
+    }
+    int error = 0;
+    for (size_t t = 0; t < sizeof(grupos) / sizeof(grupos[0]) && !error; ++t) {
+        registro_corrida reg = { .motor = "hilos", .kernel = "avx2", .agregacion = "ranuras", .reparto = "robo de trabajo",
+                                 .afinidad = "ninguna", .datos = "generadas", .semilla = 7, .trabajadores = grupos[t],
+                                 .total = TOTAL_NOTAS, .bloque_kib = 64, .inicio = time(NULL), .hist = &hist,
+                                 .n_grupos = grupos[t], .grupos = g };
+        char ruta[] = "/tmp/microbench_registro_XXXXXX";
+        int fd = mkstemp(ruta);
+        if (fd < 0) { perror("mkstemp"); error = 1; break; }
+        close(fd);
+        for (int r = 0; r < repeticiones && !error; ++r) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if (registro_agregar(ruta, &reg) != 0) { perror(ruta); error = 1; }
+            muestras[r] = 1e6 * desde(t0);
+        }
+        struct stat st;
+        long bytes = stat(ruta, &st) == 0 ? (long)st.st_size : 0;
+        unlink(ruta);
+        resumen_muestras res;
+        resumir(muestras, repeticiones, &res);
+        printf("%-7d | %10.1f | %10ld\n", grupos[t], res.mediana, bytes / repeticiones);
+    }
+    free(g);
+    free(muestras);
+    return error ? -1 : 0;
+}
+
+static void uso(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [-r N] [-m MIB] [-k LISTA] [-a ARCHIVO] [-s SECCIONES]\n"
+            "  -r N      repeticiones por medición; se reporta la mediana (por defecto 7)\n"
+            "  -m MIB    tamaño máximo del arreglo en memoria, desde 4 KiB duplicando (por defecto 1024)\n"
+            "  -k LISTA  kernels a medir separados por comas (por defecto, todos los que soporta la CPU)\n"
+            "  -a RUTA   mide además la clasificación sobre un archivo de notas (ver --exportar)\n"
+            "            leído por ventanas y sin caché de páginas: con uno mayor que la RAM se\n"
+            "            mide la lectura desde el disco\n"
+            "  -s LISTA  secciones a medir: kernel, reduccion, registro (por defecto todas)\n"
+            "Ejemplo: %s -m 4096 -a notas_grandes.bin\n",
+            prog, prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int repeticiones = 7;
+    long maximo = 1024L << 20;
+    const char *archivo = NULL, *lista = NULL, *secciones = "kernel,reduccion,registro";
+    int c;
+    while ((c = getopt(argc, argv, "r:m:k:a:s:h")) != -1) {
+        switch (c) {
+        case 'r': repeticiones = atoi(optarg); break;
+        case 'm': maximo = atol(optarg) << 20; break;
+        case 'k': lista = optarg; break;
+        case 'a': archivo = optarg; break;
+        case 's': secciones = optarg; break;
+        case 'h': uso(argv[0]); return EXIT_SUCCESS;
+        default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (repeticiones < 1 || maximo < (4L << 10) || optind < argc) {
+        uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Kernels pedidos o todos los que la CPU soporta (con notas de 4 bytes solo ramas y escalar)
+    const char *kernels[MAX_KERNELS];
+    int n_kernels = 0;
+    char *copia = lista ? strdup(lista) : NULL;
+    if (copia) {
+        for (char *k = strtok(copia, ","); k && n_kernels < MAX_KERNELS; k = strtok(NULL, ",")) {
+            if (!seleccionar_kernel(k)) { fprintf(stderr, "Kernel no disponible: %s\n", k); return EXIT_FAILURE; }
+            kernels[n_kernels++] = k;
+        }
+    } else {
+        for (size_t k = 0; k < sizeof(todos_kernels) / sizeof(todos_kernels[0]); ++k)
+            if (seleccionar_kernel(todos_kernels[k])) kernels[n_kernels++] = todos_kernels[k];
+    }
+
+    char buf[32];
+    printf("Microbenchmarks: %zu byte(s) por nota | L1 %s",
+           sizeof(nota_t), legible(cache(_SC_LEVEL1_DCACHE_SIZE, 32L << 10), buf, sizeof(buf)));
+    printf(" | L2 %s", legible(cache(_SC_LEVEL2_CACHE_SIZE, 1L << 20), buf, sizeof(buf)));
+    printf(" | L3 %s", legible(cache(_SC_LEVEL3_CACHE_SIZE, 32L << 20), buf, sizeof(buf)));
+    printf(" | RAM %s\n", legible(sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE), buf, sizeof(buf)));
+
+    int error = 0;
+    if (strstr(secciones, "kernel")) {
+        error |= medir_kernels(kernels, n_kernels, maximo, repeticiones) != 0;
+        if (archivo) error |= medir_archivo(archivo, kernels[n_kernels - 1], repeticiones) != 0;
+    }
+    if (strstr(secciones, "reduccion")) medir_reduccion(repeticiones);
+    if (strstr(secciones, "registro")) error |= medir_registro(repeticiones) != 0;
+    free(copia);
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
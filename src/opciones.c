@@ -0,0 +1,338 @@
+#include "opciones.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "agregacion.h"
+#include "agrupacion.h"
+#include "comun.h"
+#include "histograma.h"
+#include "planificador.h"
+#include "registro.h"
+
+static void uso(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [opciones]\n"
+            "  -s, --semilla N   semilla del generador (misma semilla = mismas notas)\n"
+            "  -k, --kernel K    kernel de clasificación: auto, ramas, escalar, sse4, avx2\n"
+            "  -n, --trabajadores N  hilos o procesos a usar (por defecto, núcleos en línea)\n"
+            "  -b, --barrido     mide con 1, 2, 4 ... N trabajadores y reporta el escalado\n"
+            "  -a, --agregacion M  totales globales con: mutex, atomico o ranuras (por defecto)\n"
+            "      --bloque KIB  tamaño de los bloques que se reparten los trabajadores (por defecto %d)\n"
+            "      --estatico    cada trabajador procesa solo su tramo (sin robo de trabajo ni cursor)\n"
+            "      --afinidad P  fija cada trabajador a una CPU: ninguna (por defecto), compacta,\n"
+            "                    dispersa (alterna nodos NUMA) o una lista como 0,2,4-7\n"
+            "      --total N     cantidad de notas a generar (por defecto %d)\n"
+            "      --archivo RUTA  lee las notas de un archivo binario (ver --exportar) con mmap\n"
+            "      --ventana MIB lee el archivo por ventanas de MIB MiB: la memoria residente queda\n"
+            "                    acotada sin importar el tamaño del archivo\n"
+            "      --exportar RUTA  escribe --total notas generadas con --semilla en RUTA y termina\n"
+            "                    (con --secciones, además una clave por nota)\n"
+            "      --historial RUTA  agrega el registro de la corrida a RUTA, una línea JSON por\n"
+            "                    corrida (por defecto no se registra; \"%s\" lo desactiva)\n"
+            "      --histograma  cada trabajador arma un histograma de %d clases en la misma pasada;\n"
+            "                    se reportan mínimo, máximo, media, varianza, mediana y percentiles.\n"
+            "                    Cuesta más que clasificar: en un hilo unos 1.5 GB/s contra 2 del\n"
+            "                    kernel escalar y 14-24 del avx2 (ver microbench)\n"
+            "      --cortes LISTA  con --histograma, cuenta las notas por tramos con estos límites\n"
+            "                    (por ejemplo 10,18,28; por defecto 18,28). Solo cambia los tramos\n"
+            "                    del informe global: las líneas por trabajador y el historial siguen\n"
+            "                    con las tres categorías (el historial guarda además las %d clases)\n"
+            "      --agrupar     agrupa las notas por su clave (sección): promedio y categorías por\n"
+            "                    clave con tablas por trabajador y mezcla por particiones, sin bloqueos.\n"
+            "                    Las claves vienen del archivo o se generan con --secciones\n"
+            "      --secciones N claves distintas a generar (por defecto %d)\n"
+            "      --salida-grupos RUTA  con --agrupar, escribe una fila CSV por clave en RUTA\n"
+            "      --instantanea RUTA  guarda en RUTA el histograma de cada trabajador; si ya existe,\n"
+            "                    solo procesa las notas agregadas desde entonces y las pliega en ella\n"
+            "                    (implica --histograma)\n"
+            "      --correcciones RUTA  con --instantanea y --archivo, corrige en el archivo y en la\n"
+            "                    instantánea las notas de RUTA (una línea \"POSICION NOTA\" por nota)\n"
+            "      --verificar   con --instantanea, recalcula todo y lo compara con el plegado\n"
+            "      --contadores  mide el bucle de cada trabajador con perf_event_open (ciclos,\n"
+            "                    instrucciones, fallos de LLC, de predicción y de dTLB) y getrusage\n"
+            "                    (fallos de página y cambios de contexto)\n"
+            "      --tuberia     (hilos) tubería de ingreso y agregación: productores generan o leen\n"
+            "                    (con pread) trozos del tamaño de bloque en colas circulares sin\n"
+            "                    bloqueos mientras los trabajadores los procesan; reporta la capacidad\n"
+            "                    de cada etapa, la ocupación de la cola y el cuello de botella\n"
+            "      --productores N  con --tuberia, hilos productores (por defecto, la mitad de los trabajadores)\n"
+            "      --procesos P  (híbrido) reparte los --trabajadores hilos entre P procesos\n"
+            "                    (por defecto, uno por nodo NUMA)\n"
+            "      --servir      crea los trabajadores y las notas una sola vez y atiende consultas\n"
+            "                    de agregación de stdin (todo | rango INICIO CANTIDAD | salir),\n"
+            "                    reportando latencia p50/p99 y consultas por segundo\n"
+            "      --socket RUTA con --servir, atiende las consultas en un socket Unix\n"
+            "      --shm         (procesos) datos en memfd/shm con páginas enormes y trabajadores\n"
+            "                    lanzados con posix_spawn que se adjuntan por nombre, sin fork\n"
+            "      --trabajador G --control NOMBRE\n"
+            "                    (procesos) ejecuta solo el grupo G adjuntándose a una corrida existente\n"
+            "  -h, --ayuda       muestra esta ayuda\n",
+            prog, BLOQUE_KIB_DEFECTO, TOTAL_NOTAS, HISTORIAL_NINGUNO, N_CLASES, N_CLASES,
+            SECCIONES_DEFECTO);
+}
+
+void parsear_opciones(int argc, char *argv[], opciones *op)
+{
+    static const struct option largas[] = {
+        { "semilla", required_argument, NULL, 's' },
+        { "seed",    required_argument, NULL, 's' },
+        { "kernel",  required_argument, NULL, 'k' },
+        { "trabajadores", required_argument, NULL, 'n' },
+        { "barrido", no_argument,       NULL, 'b' },
+        { "agregacion", required_argument, NULL, 'a' },
+        { "bloque",  required_argument, NULL, 'B' },
+        { "estatico", no_argument,      NULL, 'E' },
+        { "afinidad", required_argument, NULL, 'A' },
+        { "total",   required_argument, NULL, 'N' },
+        { "archivo", required_argument, NULL, 'f' },
+        { "ventana", required_argument, NULL, 'W' },
+        { "exportar", required_argument, NULL, 'X' },
+        { "historial", required_argument, NULL, 'H' },
+        { "histograma", no_argument,    NULL, 'G' },
+        { "cortes",  required_argument, NULL, 'K' },
+        { "agrupar", no_argument,       NULL, 'R' },
+        { "secciones", required_argument, NULL, 'Y' },
+        { "salida-grupos", required_argument, NULL, 'O' },
+        { "instantanea", required_argument, NULL, 'I' },
+        { "correcciones", required_argument, NULL, 'J' },
+        { "verificar", no_argument,     NULL, 'V' },
+        { "contadores", no_argument,    NULL, 'M' },
+        { "tuberia", no_argument,       NULL, 'P' },
+        { "productores", required_argument, NULL, 'D' },
+        { "procesos", required_argument, NULL, 'L' },
+        { "servir",  no_argument,       NULL, 'Q' },
+        { "socket",  required_argument, NULL, 'U' },
+        { "shm",     no_argument,       NULL, 'S' },
+        { "trabajador", required_argument, NULL, 'T' },
+        { "control", required_argument, NULL, 'C' },
+        { "ayuda",   no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    op->semilla = (uint64_t)time(NULL);
+    op->kernel  = "auto";
+    op->trabajadores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (op->trabajadores < 1) op->trabajadores = 8; /* respaldo */
+    op->barrido = 0;
+    op->agregacion = AGREGA_RANURAS;
+    op->bloque_kib = BLOQUE_KIB_DEFECTO;
+    op->estatico = 0;
+    op->afinidad = "ninguna";
+    op->total = TOTAL_NOTAS;
+    op->archivo = NULL;
+    op->ventana_mib = 0;
+    op->exportar = NULL;
+    op->histograma = 0;
+    op->cortes[0] = 18;
+    op->cortes[1] = 28;
+    op->n_cortes = 2;
+    op->agrupar = 0;
+    op->secciones = 0;
+    op->salida_grupos = NULL;
+    op->instantanea = NULL;
+    op->correcciones = NULL;
+    op->verificar = 0;
+    op->contadores = 0;
+    op->tuberia = 0;
+    op->productores = 0;
+    op->procesos = 0;
+    op->servir = 0;
+    op->socket = NULL;
+    op->shm = 0;
+    op->trabajador = -1;
+    op->control = NULL;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "s:k:n:ba:h", largas, NULL)) != -1) {
+        char *fin;
+        switch (c) {
+        case 's':
+            op->semilla = strtoull(optarg, &fin, 0);
+            if (*fin != '\0') { fprintf(stderr, "Semilla inválida: %s\n", optarg); exit(EXIT_FAILURE); }
+            break;
+        case 'k':
+            op->kernel = optarg;
+            break;
+        case 'n':
+            op->trabajadores = (int)strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->trabajadores < 1) {
+                fprintf(stderr, "Cantidad de trabajadores inválida: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            op->barrido = 1;
+            break;
+        case 'a':
+            op->agregacion = agregacion_desde_texto(optarg);
+            if (op->agregacion < 0) { fprintf(stderr, "Agregación inválida: %s\n", optarg); exit(EXIT_FAILURE); }
+            break;
+        case 'B':
+            op->bloque_kib = strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->bloque_kib < 1) {
+                fprintf(stderr, "Tamaño de bloque inválido: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'E':
+            op->estatico = 1;
+            break;
+        case 'A':
+            op->afinidad = optarg;
+            break;
+        case 'N':
+            op->total = strtol(optarg, &fin, 0);
+            if (*fin != '\0' || op->total < 1) {
+                fprintf(stderr, "Cantidad de notas inválida: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            op->archivo = optarg;
+            break;
+        case 'W':
+            op->ventana_mib = strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->ventana_mib < 1) {
+                fprintf(stderr, "Tamaño de ventana inválido: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'X':
+            op->exportar = optarg;
+            break;
+        case 'H':
+            op->historial = strcmp(optarg, HISTORIAL_NINGUNO) == 0 ? NULL : optarg;
+            break;
+        case 'G':
+            op->histograma = 1;
+            break;
+        case 'K':
+            op->n_cortes = leer_cortes(optarg, op->cortes);
+            if (op->n_cortes < 0) {
+                fprintf(stderr, "Cortes inválidos: %s (enteros crecientes entre 1 y %d)\n", optarg, MAX_NOTA);
+                exit(EXIT_FAILURE);
+            }
+            op->histograma = 1;
+            break;
+        case 'R':
+            op->agrupar = 1;
+            break;
+        case 'Y': {
+            long long n = strtoll(optarg, &fin, 0);
+            if (*fin != '\0' || n < 1 || n >= (long long)CLAVE_VACIA) {
+                fprintf(stderr, "Cantidad de secciones inválida: %s (entre 1 y %u)\n", optarg, CLAVE_VACIA - 1);
+                exit(EXIT_FAILURE);
+            }
+            op->secciones = (uint32_t)n;
+            break;
+        }
+        case 'O':
+            op->salida_grupos = optarg;
+            op->agrupar = 1;
+            break;
+        case 'I':
+            op->instantanea = optarg;
+            op->histograma = 1;
+            break;
+        case 'J':
+            op->correcciones = optarg;
+            break;
+        case 'V':
+            op->verificar = 1;
+            break;
+        case 'M':
+            op->contadores = 1;
+            break;
+        case 'P':
+            op->tuberia = 1;
+            break;
+        case 'D':
+            op->productores = (int)strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->productores < 1) {
+                fprintf(stderr, "Cantidad de productores inválida: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            op->tuberia = 1;
+            break;
+        case 'L':
+            op->procesos = (int)strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->procesos < 1) {
+                fprintf(stderr, "Cantidad de procesos inválida: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'Q':
+            op->servir = 1;
+            break;
+        case 'U':
+            op->socket = optarg;
+            break;
+        case 'S':
+            op->shm = 1;
+            break;
+        case 'T':
+            op->trabajador = (int)strtol(optarg, &fin, 10);
+            if (*fin != '\0' || op->trabajador < 0) {
+                fprintf(stderr, "Trabajador inválido: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'C':
+            op->control = optarg;
+            break;
+        case 'h':
+            uso(argv[0]);
+            exit(EXIT_SUCCESS);
+        default:
+            uso(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (op->ventana_mib && !op->archivo) {
+        fprintf(stderr, "--ventana requiere --archivo\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->socket && !op->servir) {
+        fprintf(stderr, "--socket requiere --servir\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->servir && op->barrido) {
+        fprintf(stderr, "--servir y --barrido no se pueden combinar\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->agrupar && (op->servir || op->barrido || op->ventana_mib)) {
+        fprintf(stderr, "--agrupar no se puede combinar con --servir, --barrido ni --ventana\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((op->correcciones || op->verificar) && !op->instantanea) {
+        fprintf(stderr, "--correcciones y --verificar requieren --instantanea\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->correcciones && !op->archivo) {
+        fprintf(stderr, "--correcciones requiere --archivo (las notas generadas no se pueden corregir)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->instantanea && (op->servir || op->barrido || op->agrupar)) {
+        fprintf(stderr, "--instantanea no se puede combinar con --servir, --barrido ni --agrupar\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->tuberia && (op->servir || op->barrido || op->agrupar || op->ventana_mib || op->instantanea)) {
+        fprintf(stderr, "--tuberia no se puede combinar con --servir, --barrido, --agrupar, --ventana ni --instantanea\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->contadores && (op->servir || op->barrido)) {
+        fprintf(stderr, "--contadores no se puede combinar con --servir ni --barrido\n");
+        exit(EXIT_FAILURE);
+    }
+    if (op->tuberia && op->productores == 0)
+        op->productores = op->trabajadores / 2 > 0 ? op->trabajadores / 2 : 1;
+    if (op->trabajador >= 0 && !op->control) {
+        fprintf(stderr, "--trabajador requiere --control\n");
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef OPCIONES_H
+#define OPCIONES_H
+
+#include <stdint.h>
+
+#include "comun.h"
+
+/* Opciones de línea de comandos comunes a ambos motores */
+typedef struct {
+    uint64_t semilla;     // Semilla del generador de notas
+    const char *kernel;   // Kernel de clasificación pedido ("auto" por defecto)
+    int trabajadores;     // Hilos o procesos hijos (por defecto, núcleos en línea)
+    int barrido;          // 1: medir con 1, 2, 4 ... trabajadores sobre los mismos datos
+    int agregacion;       // modo_agregacion de los totales globales (ranuras por defecto)
+    long bloque_kib;      // Tamaño de los bloques del planificador en KiB
+    int estatico;         // 1: cada trabajador procesa solo su tramo, sin repartir bloques
+    const char *afinidad; // Política de afinidad: ninguna, compacta, dispersa o lista de CPUs
+    long total;           // Notas a generar (TOTAL_NOTAS por defecto)
+    const char *archivo;  // Archivo binario de notas a leer en lugar de generarlas
+    long ventana_mib;     // > 0: lee el archivo por ventanas de este tamaño en MiB
+    const char *exportar; // Escribe las notas generadas en este archivo y termina
+    const char *historial; // Archivo al que se agrega el registro de la corrida (NULL: ninguno)
+    int histograma;       // 1: cada trabajador arma el histograma de notas (media, varianza, percentiles)
+    int cortes[MAX_NOTA]; // Límites de los tramos del histograma (por defecto 18 y 28)
+    int n_cortes;
+    int agrupar;          // 1: agrupa las notas por su clave (sección) con tablas por trabajador
+    uint32_t secciones;   // Claves distintas a generar (0: SECCIONES_DEFECTO; con --exportar, 0 = sin claves)
+    const char *salida_grupos; // Con --agrupar: CSV con una fila por clave (NULL: no se escribe)
+    const char *instantanea; // Instantánea del histograma: se crea o se le pliegan solo las notas nuevas
+    const char *correcciones; // Con --instantanea y --archivo: notas a corregir ("POSICION NOTA" por línea)
+    int verificar;        // 1: compara el plegado incremental con un recálculo completo
+    int contadores;       // 1: mide por trabajador ciclos, instrucciones, fallos de caché, de predicción y de TLB
+    int tuberia;          // 1: (hilos) productores generan o leen trozos mientras los trabajadores los procesan
+    int productores;      // Con --tuberia: hilos productores (por defecto, la mitad de los trabajadores)
+    int procesos;         // (híbrido) procesos entre los que se reparten los trabajadores (0: uno por nodo NUMA)
+    int servir;           // 1: deja el grupo de trabajadores vivo y atiende consultas
+    const char *socket;   // Con --servir: socket Unix donde se atienden (NULL: stdin)
+    int shm;              // 1: datos en memoria compartida con nombre y trabajadores lanzados aparte (procesos)
+    int trabajador;       // >= 0: este proceso es el trabajador indicado y se adjunta a --control
+    const char *control;  // Nombre de la región de control a la que se adjunta un trabajador
+} opciones;
+
+/*
+ * Lee argv y llena op. Sin --semilla se usa time(NULL), como antes.
+ * Termina el programa con el mensaje de uso si hay una opción inválida.
+ */
+void parsear_opciones(int argc, char *argv[], opciones *op);
+
+#endif
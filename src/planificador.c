@@ -0,0 +1,122 @@
+#include "planificador.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "comun.h"
+
+#define EMPAQUETAR(i, f) (((uint64_t)(i) << 32) | (uint32_t)(f))
+#define INICIO(r)        ((long)((r) >> 32))
+#define FIN(r)           ((long)(uint32_t)(r))
+
+size_t planificador_tamano(int n)
+{
+    return sizeof(planificador) + sizeof(cola_bloques) * (size_t)n;
+}
+
+int planificador_admite(long total, long tam_bloque)
+{
+    return (total + tam_bloque - 1) / tam_bloque <= (long)UINT32_MAX ? 0 : -1;
+}
+
+void planificador_iniciar(planificador *p, modo_reparto modo, int n, long total, long tam_bloque)
+{
+    memset(p, 0, planificador_tamano(n));
+    p->modo = modo;
+    p->n = n;
+    p->total = total;
+    p->tam_bloque = tam_bloque;
+    p->n_bloques = (total + tam_bloque - 1) / tam_bloque;
+    atomic_init(&p->cursor, 0);
+    for (int i = 0; i < n; ++i) {
+        long ini = p->n_bloques * i / n, fin = p->n_bloques * (i + 1) / n;
+        atomic_init(&p->colas[i].rango, EMPAQUETAR(ini, fin));
+    }
+}
+
+planificador *planificador_nuevo(modo_reparto modo, int n, long total, long tam_bloque)
+{
+    size_t bytes = (planificador_tamano(n) + LINEA_CACHE - 1) & ~(size_t)(LINEA_CACHE - 1);
+    planificador *p = aligned_alloc(LINEA_CACHE, bytes);
+    if (p) planificador_iniciar(p, modo, n, total, tam_bloque);
+    return p;
+}
+
+void planificador_tramo(const planificador *p, int id, long *inicio, long *cantidad)
+{
+    long ini = p->n_bloques * id / p->n, fin = p->n_bloques * (id + 1) / p->n;
+    long hasta = fin * p->tam_bloque < p->total ? fin * p->tam_bloque : p->total;
+    *inicio = ini * p->tam_bloque;
+    *cantidad = hasta - *inicio;
+}
+
+/* Convierte el índice de bloque b en el rango de notas que cubre */
+static int entregar(const planificador *p, long b, long *inicio, long *cantidad)
+{
+    *inicio = b * p->tam_bloque;
+    *cantidad = (b == p->n_bloques - 1) ? p->total - *inicio : p->tam_bloque;
+    return 1;
+}
+
+/* El dueño toma el primer bloque de su cola; retorna -1 si está vacía */
+static long tomar_propio(cola_bloques *cola)
+{
+    uint64_t r = atomic_load_explicit(&cola->rango, memory_order_acquire);
+    while (INICIO(r) < FIN(r)) {
+        if (atomic_compare_exchange_weak(&cola->rango, &r, EMPAQUETAR(INICIO(r) + 1, FIN(r))))
+            return INICIO(r);
+    }
+    return -1;
+}
+
+/*
+ * Roba la mitad final de la cola de la víctima y la deja en la cola del ladrón
+ * (que está vacía). Retorna 1 si consiguió algo.
+ */
+static int robar(cola_bloques *victima, cola_bloques *propia)
+{
+    uint64_t r = atomic_load_explicit(&victima->rango, memory_order_acquire);
+    while (INICIO(r) < FIN(r)) {
+        long quedan = FIN(r) - INICIO(r);
+        long robados = (quedan + 1) / 2;
+        long corte = FIN(r) - robados;
+        if (atomic_compare_exchange_weak(&victima->rango, &r, EMPAQUETAR(INICIO(r), corte))) {
+            atomic_store_explicit(&propia->rango, EMPAQUETAR(corte, FIN(r)), memory_order_release);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int planificador_siguiente(planificador *p, int id, long *inicio, long *cantidad, double *busqueda)
+{
+    if (p->modo == REPARTO_CURSOR) {
+        long b = atomic_fetch_add_explicit(&p->cursor, 1, memory_order_relaxed);
+        return b < p->n_bloques ? entregar(p, b, inicio, cantidad) : 0;
+    }
+
+    long b = tomar_propio(&p->colas[id]);
+    if (b >= 0) return entregar(p, b, inicio, cantidad);
+    if (p->modo == REPARTO_ESTATICO) return 0;
+
+    // Cola vacía: recorre a los demás empezando por el vecino siguiente
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int conseguido = 0;
+    for (int k = 1; k < p->n && !conseguido; ++k) {
+        if (robar(&p->colas[(id + k) % p->n], &p->colas[id])) {
+            b = tomar_propio(&p->colas[id]);
+            conseguido = b >= 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *busqueda += segundos_entre(t0, t1);
+    return conseguido ? entregar(p, b, inicio, cantidad) : 0;
+}
+
+const char *reparto_nombre(modo_reparto modo)
+{
+    static const char *nombres[] = { "estático", "robo de trabajo", "cursor atómico" };
+    return nombres[modo];
+}
@@ -0,0 +1,77 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agregacion.h"   // LINEA_CACHE
+
+#define BLOQUE_KIB_DEFECTO 64   // Tamaño de bloque por defecto (cabe holgado en L2)
+
+/* Forma de repartir los bloques entre trabajadores */
+typedef enum {
+    REPARTO_ESTATICO, // Cada trabajador procesa solo su tramo, como antes
+    REPARTO_ROBO,     // Cola por trabajador; el que se queda sin trabajo roba la mitad a otro
+    REPARTO_CURSOR    // Un cursor atómico compartido entrega el siguiente bloque libre
+} modo_reparto;
+
+/*
+ * Cola de bloques de un trabajador: el rango [inicio, fin) de índices de bloque
+ * empaquetado en 64 bits para tomar y robar con una sola comparación-intercambio.
+ * El dueño toma por el frente y los ladrones se llevan la mitad del final.
+ */
+typedef struct {
+    _Alignas(LINEA_CACHE) _Atomic uint64_t rango;
+} cola_bloques;
+
+/*
+ * Planificador por bloques del tamaño de la caché. Sin punteros: puede vivir
+ * en memoria compartida entre procesos.
+ */
+typedef struct {
+    modo_reparto modo;
+    int n;                    // Trabajadores
+    long total;               // Notas a repartir
+    long tam_bloque;          // Notas por bloque
+    long n_bloques;           // Bloques en total
+    _Alignas(LINEA_CACHE) _Atomic long cursor; // Siguiente bloque libre (REPARTO_CURSOR)
+    cola_bloques colas[];     // Una por trabajador (REPARTO_ROBO)
+} planificador;
+
+/* Bytes necesarios para un planificador de n trabajadores */
+size_t planificador_tamano(int n);
+
+/*
+ * Retorna 0 si total notas en bloques de tam_bloque caben en las colas, cuyos
+ * índices de bloque ocupan 32 bits; -1 si hay más de UINT32_MAX bloques.
+ */
+int planificador_admite(long total, long tam_bloque);
+
+/*
+ * Divide total notas en bloques de tam_bloque y da a cada trabajador un tramo
+ * contiguo de bloques en su cola. Si hay más trabajadores que bloques, algunos
+ * empiezan con la cola vacía. Requiere planificador_admite(total, tam_bloque).
+ */
+void planificador_iniciar(planificador *p, modo_reparto modo, int n, long total, long tam_bloque);
+
+/* Reserva (alineado a línea de caché) e inicia un planificador privado; NULL si falla */
+planificador *planificador_nuevo(modo_reparto modo, int n, long total, long tam_bloque);
+
+/*
+ * Rango de notas [*inicio, *inicio + *cantidad) del tramo inicial del trabajador id.
+ * Es el que genera cada trabajador, así que empieza leyendo lo que él mismo escribió.
+ */
+void planificador_tramo(const planificador *p, int id, long *inicio, long *cantidad);
+
+/*
+ * Entrega al trabajador id el siguiente bloque a procesar en [*inicio, *inicio + *cantidad).
+ * Con REPARTO_ROBO, si su cola está vacía intenta robar; el tiempo de esa búsqueda
+ * se suma a *busqueda. Retorna 0 cuando ya no queda trabajo para él.
+ */
+int planificador_siguiente(planificador *p, int id, long *inicio, long *cantidad, double *busqueda);
+
+/* Nombre del modo para los reportes */
+const char *reparto_nombre(modo_reparto modo);
+
+#endif
@@ -3,197 +3,924 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <time.h>
 #include <fcntl.h>
 #include <sys/stat.h>
-#include <semaphore.h>
+#include <spawn.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
 
-/* Parámetros de escalado */
-#define TOTAL_NOTAS      20000000            // Total de notas a procesar
-#define N_GRUPOS         8                   // Número de procesos hijos
-#define NOTAS_POR_GRUPO (TOTAL_NOTAS / N_GRUPOS) // Notas por cada hijo
-#define MAX_NOTA         40                  // Nota máxima posible
-#define SEM_NAME         "/file_sem"        // Nombre del semáforo POSIX
+#include "comun.h"
+#include "afinidad.h"
+#include "agregacion.h"
+#include "agrupacion.h"
+#include "archivo.h"
+#include "barrido.h"
+#include "clasificacion.h"
+#include "contadores.h"
+#include "generador.h"
+#include "hijos.h"
+#include "histograma.h"
+#include "instantanea.h"
+#include "memoria.h"
+#include "opciones.h"
+#include "planificador.h"
+#include "registro.h"
+#include "servidor.h"
 
-// Estructura para almacenar el resultado de cada grupo
+extern char **environ;
+
+// Estructura para almacenar el resultado de cada grupo (una línea de caché propia por hijo)
 typedef struct {
-    char letra;         // Letra identificadora del grupo (A, B, ...)
+    _Alignas(LINEA_CACHE) char etiqueta[ETIQUETA_MAX]; // Etiqueta del grupo (A, B, ..., Z, AA, ...)
     double promedio;    // Promedio de notas del grupo
-    int reprobados;     // Cantidad de reprobados (<18)
-    int aprobado_bajo;  // Cantidad de aprobados bajos (18-27.99)
-    int aprobado_alto;  // Cantidad de aprobados altos (28-40)
+    long long suma;     // Suma de las notas procesadas (para el promedio de una consulta)
+    histograma hist;    // Histograma de lo procesado (--histograma)
+    resumen_grupos grupos; // Resumen de la partición que mezcló este hijo (--agrupar)
+    size_t bytes_salida; // Bytes de su partición en --salida-grupos
+    long long reprobados;    // Cantidad de reprobados (<18)
+    long long aprobado_bajo; // Cantidad de aprobados bajos (18-27.99)
+    long long aprobado_alto; // Cantidad de aprobados altos (28-40)
+    long long fuera;         // Notas fuera de [0, MAX_NOTA] (un archivo ajeno: la corrida se rechaza)
+    long cantidad;      // Notas procesadas por el grupo
     double tiempo;      // Tiempo de ejecución del grupo en segundos
+    long fallos;        // Fallos de página menores del hijo durante el cómputo
+    double espera;      // Tiempo en la agregación de totales globales
+    int bloques;        // Bloques tomados del cursor compartido
+    struct timespec fin; // Momento en que terminó su último bloque (reloj común a todos)
+    double inactivo;    // Tiempo sin trabajo esperando al último hijo
+    int cpu;            // CPU en la que terminó (para el ancho de banda por nodo)
+    medicion_hw hw;     // Contadores de hardware del hijo durante el cómputo (--contadores)
 } resultado_por_grupo;
 
 /*
- * Función que escribe el resultado de un grupo en el archivo de salida.
- * filename: nombre del archivo de salida.
- * r: puntero a la estructura resultado_por_grupo con los datos del grupo.
- * Si el archivo tiene 8 o más líneas, lo reescribe; si no, agrega al final.
+ * Región de control compartida entre el padre y los hijos. Los hijos devuelven
+ * aquí su resultado; el padre los imprime y los registra en el historial al final.
+ * Después de los resultados, alineado a línea de caché, va el agregador de totales
+ * y tras él el planificador con el cursor de bloques.
  */
-static void escribir_resultado(const char *filename, const resultado_por_grupo *resultado)
-{
-    int rewrite = 0;
-    // Solo reescribe si el archivo tiene más de 11 líneas
-    FILE *archivo = fopen(filename, "r");
-    if (archivo) {
-        int lines = 0;
-        char buffer[256];
-        while (fgets(buffer, sizeof(buffer), archivo)) lines++;
-        if (lines > 12) rewrite = 1;
-        fclose(archivo);
-    }
-    archivo = fopen(filename, rewrite ? "w" : "a");
-    if (archivo) {
-        fprintf(archivo,
-                "Grupo %c | Promedio: %.2f | Reprobados: %d | Aprobados (18-27.99): %d | Aprobados (28-40): %d | Tiempo: %.6f s\n",
-                resultado->letra, resultado->promedio, resultado->reprobados, resultado->aprobado_bajo, resultado->aprobado_alto, resultado->tiempo);
-        fflush(archivo);
-        fclose(archivo);
-    }
-}
-
-// Función para escribir el tiempo total y marcas de tiempo al final del archivo de resultados
-static void escribir_tiempos_finales(const char *filename, double tiempo_total, time_t inicio, time_t fin, struct timespec t0, struct timespec t1) {
-    FILE *archivo = fopen(filename, "a");
-    if (archivo) {
-        char buf_inicio[64], buf_fin[64];
-        strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&inicio));
-        strftime(buf_fin, sizeof(buf_fin), "%a %b %d %H:%M:%S", localtime(&fin));
-        fprintf(archivo, "Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&inicio)->tm_year);
-        fprintf(archivo, "Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&fin)->tm_year);
-        fprintf(archivo, "Duración total: %.6f segundos\n", tiempo_total);
-        fflush(archivo);
-        fclose(archivo);
+typedef struct {
+    pthread_barrier_t barrera;  // Barrera entre procesos (hijos + padre)
+    pthread_barrier_t barrera_fin; // Con --servir: todos los hijos terminaron la consulta; con --agrupar, separa las fases de la mezcla (solo hijos)
+    int max_grupos;             // Capacidad de resultados y ranuras del agregador
+    int n_grupos;               // Hijos de la corrida actual
+    int generar;                // 1: cada hijo genera su bloque antes de procesarlo
+    uint64_t semilla;           // Semilla de la generación
+    char ruta_datos[64];        // Región de las notas a la que se adjuntan los hijos (--shm)
+    char ruta_archivo[4096];    // Archivo de notas que abren los hijos lanzados aparte ("" si no hay)
+    int ventanas;               // 1: el archivo se mapea bloque a bloque (--ventana)
+    int histograma;             // 1: cada hijo arma el histograma de sus notas
+    int contadores;             // 1: cada hijo mide su cómputo con contadores de hardware
+    int agrupar;                // 1: cada hijo agrupa sus notas por clave y mezcla una partición
+    uint32_t secciones;         // Claves distintas al generarlas o rango de las del archivo (corta las particiones)
+    char ruta_claves[64];       // Región de las claves a la que se adjuntan los hijos (--shm)
+    int salida;                 // Descriptor de --salida-grupos, heredado por los hijos (-1 si no hay)
+    int padre;                  // PID del padre: nombra las regiones de la mezcla por particiones
+    int servidor;               // 1: los hijos siguen vivos y atienden consultas (--servir)
+    long desde;                 // Primera nota de la consulta en curso (o la primera agregada, con --instantanea)
+    int salir;                  // 1: los hijos del servidor terminan en la próxima espera
+    _Atomic int llegados;       // Hijos que llegaron a la próxima barrera que espera el padre (ver hijos_esperar_llegadas)
+    resultado_por_grupo resultados[]; // Un resultado por grupo
+} control;
+
+/* Recursos del padre para lanzar corridas */
+typedef struct {
+    control *ctl;               // Región de control mapeada
+    nota_t *notas;              // Notas en memoria compartida o el archivo mapeado completo
+    clave_t *claves;            // Clave de cada nota (--agrupar; NULL si no se agrupa)
+    const archivo_notas *ventanas; // Archivo leído por ventanas (NULL si las notas están en memoria)
+    long total;                 // Notas a procesar
+    long desde;                 // Primera nota a procesar: el planificador reparte [desde, total)
+    int agregacion;             // modo_agregacion de los totales globales
+    modo_reparto reparto;       // Cursor atómico compartido o tramo fijo por hijo
+    long tam_bloque;            // Notas por bloque del planificador
+    int shm;                    // 1: los hijos se lanzan con posix_spawn y se adjuntan
+    const char *ruta_control;   // Nombre de la región de control (para --control)
+    const char *kernel;         // Kernel que deben usar los hijos lanzados aparte
+    const afinidad *afin;       // Política de afinidad que aplica cada hijo al comenzar
+    const char *afinidad;       // La misma política como texto, para los hijos lanzados aparte
+    hijos *hijos;               // Hijos lanzados en la corrida en curso
+} recursos;
+
+/* Costos de crear a los hijos, reportados aparte del cómputo */
+typedef struct {
+    long fallos_hijos;          // Fallos de página menores de los hijos en toda su vida
+    long fallos_computo;        // De ellos, los ocurridos durante el cómputo
+} costos;
+
+/* Desplazamiento del agregador dentro de la región de control */
+static size_t desplazamiento_agregador(int max_grupos)
+{
+    size_t bytes = sizeof(control) + sizeof(resultado_por_grupo) * (size_t)max_grupos;
+    return (bytes + LINEA_CACHE - 1) & ~(size_t)(LINEA_CACHE - 1);
+}
+
+static agregador *agregador_de(control *ctl)
+{
+    return (agregador *)((char *)ctl + desplazamiento_agregador(ctl->max_grupos));
+}
+
+/* Desplazamiento del planificador, a continuación del agregador */
+static size_t desplazamiento_planificador(int max_grupos)
+{
+    size_t bytes = desplazamiento_agregador(max_grupos) + agregador_tamano(max_grupos);
+    return (bytes + LINEA_CACHE - 1) & ~(size_t)(LINEA_CACHE - 1);
+}
+
+static planificador *planificador_de(control *ctl)
+{
+    return (planificador *)((char *)ctl + desplazamiento_planificador(ctl->max_grupos));
+}
+
+/* Fallos de página menores acumulados de quien (RUSAGE_SELF o RUSAGE_CHILDREN) */
+static long fallos_menores(int quien)
+{
+    struct rusage uso;
+    getrusage(quien, &uso);
+    return uso.ru_minflt;
+}
+
+/* Trabajo que ejecuta un hijo: una corrida (trabajar_grupo) o el servidor (atender_grupo) */
+typedef void (*trabajo_hijo)(control *ctl, nota_t *notas, clave_t *claves, const archivo_notas *ventanas,
+                             int g, const afinidad *afin);
+
+/*
+ * Procesa los bloques que el planificador le entrega al grupo g, desplazados
+ * desde notas (el comienzo del rango pedido), y los acumula en c o, si h no es
+ * NULL, en el histograma h (de donde luego sale c sin otra pasada). Si p no es
+ * NULL además agrupa cada nota por su clave en las tablas locales p.
+ * Retorna la cantidad de notas procesadas.
+ */
+static long recorrer(control *ctl, nota_t *notas, const clave_t *claves, const archivo_notas *ventanas, int g,
+                     long desde, conteo *c, histograma *h, particiones_grupos *p, int *bloques, double *busqueda)
+{
+    planificador *plan = planificador_de(ctl);
+    long inicio, tam, cantidad = 0;
+    while (planificador_siguiente(plan, g, &inicio, &tam, busqueda)) {
+        inicio += desde;
+        ventana v = {0};
+        const nota_t *datos = ventanas ? archivo_ventana(ventanas, inicio, tam, &v) : notas + inicio;
+        if (!datos) { perror("mmap"); _exit(EXIT_FAILURE); }
+        if (p) agrupar(datos, claves + inicio, tam, p);
+        if (h) histogramar(datos, tam, h);
+        else if (!p) clasificar(datos, tam, c);
+        ventana_liberar(&v);
+        cantidad += tam;
+        (*bloques)++;
     }
+    return cantidad;
 }
 
-int main(void)
+/*
+ * Mezcla por particiones entre procesos (--agrupar): cada hijo vuelca sus tablas
+ * locales en una región con nombre y, cuando todos lo hicieron, el hijo g se
+ * adjunta a las de los demás, suma la partición g de todas (ninguna clave está en
+ * dos particiones, así que no hace falta bloquear nada), la ordena por clave y
+ * escribe sus filas en su lugar de --salida-grupos.
+ */
+static void mezclar_particion(control *ctl, int g, particiones_grupos *p)
 {
+    int n = ctl->n_grupos;
+    resultado_por_grupo *propio = &ctl->resultados[g];
+    region *volcados = malloc(sizeof(region) * n);
+    if (!volcados) { perror("malloc"); _exit(EXIT_FAILURE); }
+    char nombre[64];
+    snprintf(nombre, sizeof(nombre), "/grupos_%d_%d", ctl->padre, g);
+    if (region_crear(&volcados[g], nombre, particiones_bytes(p), 0) != 0) { perror("region_crear (grupos)"); _exit(EXIT_FAILURE); }
+    particiones_volcar(p, volcados[g].base);
+    long long descartadas = p->descartadas;
+    particiones_liberar(p);
+    pthread_barrier_wait(&ctl->barrera_fin); // Todas las tablas locales volcadas
+
     struct timespec t0, t1;
-    time_t tiempo_inicio = time(NULL); // Marca de tiempo de inicio (segundos desde epoch)
-    clock_gettime(CLOCK_MONOTONIC, &t0); // Marca de tiempo alta resolución
-
-    // Reserva memoria dinámica para todas las notas (puntero)
-    int *notas = malloc(sizeof(int) * TOTAL_NOTAS); // Puntero a arreglo dinámico
-    if (!notas) { perror("malloc"); return EXIT_FAILURE; }
-
-    // Inicializa el arreglo de notas con valores aleatorios entre 0 y MAX_NOTA
-    srand((unsigned)time(NULL));
-    for (int i = 0; i < TOTAL_NOTAS; ++i)
-        notas[i] = rand() % (MAX_NOTA + 1);
-
-    // Crea o abre un semáforo POSIX para sincronizar acceso a recursos compartidos
-    sem_t *semaforo = sem_open(SEM_NAME, O_CREAT, 0666, 1); // SEM_NAME: nombre, O_CREAT: crear si no existe, permisos 0666, valor inicial 1
-    if (semaforo == SEM_FAILED) { perror("sem_open"); return EXIT_FAILURE; }
-
-    // Crea memoria compartida para acumular los totales globales de todos los grupos
-    int memoria_compartida = shm_open("/resumen_global", O_CREAT | O_RDWR, 0666); // /resumen_global: nombre, O_CREAT|O_RDWR: crear y leer/escribir, permisos 0666
-    ftruncate(memoria_compartida, 3 * sizeof(int)); // Ajusta el tamaño de la memoria compartida
-    int *resumen_global = mmap(0, 3 * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, memoria_compartida, 0); // Mapea la memoria compartida
-    resumen_global[0] = 0; // reprobados
-    resumen_global[1] = 0; // aprobado_bajo
-    resumen_global[2] = 0; // aprobado_alto
-
-
-    // Crea N_GRUPOS procesos hijos
-    for (int g = 0; g < N_GRUPOS; ++g) {
-        pid_t pid = fork(); // Crea un nuevo proceso hijo
-        if (pid < 0) { perror("fork"); return EXIT_FAILURE; }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long filas = 0, mayor = 0;
+    for (int t = 0; t < n; ++t) {
+        snprintf(nombre, sizeof(nombre), "/grupos_%d_%d", ctl->padre, t);
+        if (t != g && region_adjuntar(&volcados[t], nombre) != 0) { perror("region_adjuntar (grupos)"); _exit(EXIT_FAILURE); }
+        long m;
+        particion_volcada(volcados[t].base, g, &m);
+        filas += m;
+        if (m > mayor) mayor = m;
+    }
+    // La partición tiene al menos tantas claves como el mayor volcado (la suma las sobrestima n veces)
+    tabla_grupos final = {0};
+    if (tabla_reservar(&final, mayor) != 0) { perror("malloc"); _exit(EXIT_FAILURE); }
+    for (int t = 0; t < n; ++t) {
+        long m;
+        const fila_grupo *desde = particion_volcada(volcados[t].base, g, &m);
+        tabla_mezclar(&final, desde, m);
+    }
+    long claves = tabla_ordenar(&final);
+    grupos_resumir(final.filas, claves, &propio->grupos);
+    propio->grupos.filas_locales = filas;
+    propio->grupos.descartadas = descartadas;
+    char *texto = NULL;
+    size_t bytes = 0;
+    if (ctl->salida >= 0 && !(texto = grupos_csv(final.filas, claves, &bytes))) { perror("malloc"); _exit(EXIT_FAILURE); }
+    propio->bytes_salida = bytes;
+    pthread_barrier_wait(&ctl->barrera_fin); // Todas las particiones mezcladas y con su tamaño en la salida
+
+    for (int t = 0; t < n; ++t) region_liberar(&volcados[t], t == g); // Cada hijo borra su volcado
+    free(volcados);
+    if (texto) {
+        // Cada partición va a continuación de las anteriores: todos escriben a la vez
+        off_t desde = (off_t)strlen(GRUPOS_CABECERA_CSV);
+        for (int t = 0; t < g; ++t) desde += (off_t)ctl->resultados[t].bytes_salida;
+        if (grupos_escribir(ctl->salida, texto, bytes, desde) != 0) perror("--salida-grupos");
+        free(texto);
+    }
+    tabla_liberar(&final);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    propio->grupos.local  = propio->tiempo;
+    propio->grupos.mezcla = segundos_entre(t0, t1);
+}
+
+/* Borra los volcados de la mezcla que dejaron hijos muertos antes de liberarlos */
+static void borrar_volcados(const control *ctl)
+{
+    char nombre[64];
+    for (int t = 0; t < ctl->n_grupos; ++t) {
+        snprintf(nombre, sizeof(nombre), "/grupos_%d_%d", ctl->padre, t);
+        shm_unlink(nombre);   // Los que ya se borraron fallan con ENOENT
+    }
+}
+
+/*
+ * Trabajo de un hijo: se fija a su CPU (si hay política de afinidad) para que el
+ * tramo del grupo g que genera quede en su nodo NUMA, luego toma bloques del
+ * cursor compartido hasta que se acaban, deja su resultado en ctl->resultados[g]
+ * y suma a los totales globales.
+ * ventanas: si no es NULL, cada bloque se mapea del archivo solo mientras se procesa.
+ * Sirve igual para hijos creados con fork() y para los lanzados con posix_spawn().
+ */
+static void trabajar_grupo(control *ctl, nota_t *notas, clave_t *claves, const archivo_notas *ventanas,
+                           int g, const afinidad *afin)
+{
+    afinidad_fijar(afin, g);
+    if (ctl->generar) {
+        long inicio, tam;
+        planificador_tramo(planificador_de(ctl), g, &inicio, &tam);
+        inicio += ctl->desde;
+        generar_notas(notas, inicio, tam, ctl->semilla);
+        if (ctl->agrupar) generar_claves_en(claves + inicio, inicio, tam, ctl->semilla, ctl->secciones);
+    }
+    atomic_fetch_add_explicit(&ctl->llegados, 1, memory_order_release);
+    pthread_barrier_wait(&ctl->barrera); // Todos los bloques listos antes de medir
+    pthread_barrier_wait(&ctl->barrera); // El padre ya marcó el inicio
+
+    struct timespec t0g, t1g;
+    long fallos0 = fallos_menores(RUSAGE_SELF);
+    clock_gettime(CLOCK_MONOTONIC, &t0g); // Marca de tiempo inicial del grupo
+    conteo c = {0};
+    int bloques = 0;
+    double busqueda = 0;
+    histograma *h = ctl->histograma ? &ctl->resultados[g].hist : NULL;
+    if (h) memset(h, 0, sizeof(*h));
+    particiones_grupos tablas, *p = ctl->agrupar ? &tablas : NULL;
+    if (p && particiones_iniciar(p, ctl->n_grupos, ctl->secciones) != 0) { perror("malloc"); _exit(EXIT_FAILURE); }
+    contadores cont;
+    if (ctl->contadores) contadores_iniciar(&cont);
+    long cantidad = recorrer(ctl, notas, claves, ventanas, g, ctl->desde, &c, h, p, &bloques, &busqueda);
+    if (ctl->contadores) contadores_detener(&cont, &ctl->resultados[g].hw);
+    if (h) histograma_conteo(h, &c);
+    else if (p) particiones_conteo(p, &c);
+    clock_gettime(CLOCK_MONOTONIC, &t1g); // Marca de tiempo final del grupo
+
+    // Llena el resultado del grupo directamente en memoria compartida
+    resultado_por_grupo *resultado = &ctl->resultados[g];
+    etiqueta_grupo(g, resultado->etiqueta);
+    long en_rango = h ? cantidad - h->fuera : cantidad;   // La suma del histograma no incluye las fuera de rango
+    resultado->promedio      = en_rango ? (double)c.suma / en_rango : 0;
+    resultado->suma          = c.suma;
+    resultado->reprobados    = c.reprobados;
+    resultado->aprobado_bajo = c.aprobado_bajo;
+    resultado->aprobado_alto = c.aprobado_alto;
+    resultado->fuera         = c.fuera;
+    resultado->cantidad      = cantidad;
+    resultado->tiempo        = segundos_entre(t0g, t1g);
+    resultado->fallos        = fallos_menores(RUSAGE_SELF) - fallos0;
+    resultado->bloques       = bloques;
+    resultado->fin           = t1g;
+    resultado->cpu           = sched_getcpu();
+
+    // Actualiza los totales globales en memoria compartida (con mutex, atómicos o en su ranura)
+    agregador *totales = agregador_de(ctl);
+    agregador_sumar(totales, g, &c);
+    resultado->espera = totales->ranuras[g].espera;
+    if (p) mezclar_particion(ctl, g, p);
+}
+
+/*
+ * Trabajo de un hijo del servidor (--servir): genera su tramo como trabajar_grupo()
+ * y luego atiende una consulta por cada vuelta de las barreras, dejando su suma
+ * en ctl->resultados[g] y sus conteos en el agregador, hasta que el padre pide salir.
+ */
+static void atender_grupo(control *ctl, nota_t *notas, clave_t *claves, const archivo_notas *ventanas,
+                          int g, const afinidad *afin)
+{
+    (void)claves;   // --servir no agrupa
+    afinidad_fijar(afin, g);
+    if (ctl->generar) {
+        long inicio, tam;
+        planificador_tramo(planificador_de(ctl), g, &inicio, &tam);
+        generar_notas(notas, inicio, tam, ctl->semilla);
+    }
+    atomic_fetch_add_explicit(&ctl->llegados, 1, memory_order_release);
+    pthread_barrier_wait(&ctl->barrera_fin); // Notas listas
+    for (;;) {
+        pthread_barrier_wait(&ctl->barrera);
+        if (ctl->salir) break;
+        conteo c = {0};
+        int bloques = 0;
+        double busqueda = 0;
+        ctl->resultados[g].cantidad = recorrer(ctl, notas, NULL, ventanas, g, ctl->desde, &c, NULL, NULL, &bloques, &busqueda);
+        ctl->resultados[g].suma     = c.suma;
+        ctl->resultados[g].fuera    = c.fuera;
+        agregador_sumar(agregador_de(ctl), g, &c);
+        atomic_fetch_add_explicit(&ctl->llegados, 1, memory_order_release);
+        pthread_barrier_wait(&ctl->barrera_fin);
+    }
+}
+
+/*
+ * Punto de entrada de un trabajador lanzado aparte (--trabajador G --control NOMBRE):
+ * se adjunta a la región de control y a la de datos por nombre (o abre el archivo
+ * de notas), sin heredar nada del padre.
+ */
+static int main_trabajador(const opciones *op)
+{
+    static afinidad afin;
+    if (afinidad_preparar(&afin, op->afinidad) != 0) { fprintf(stderr, "Afinidad inválida: %s\n", op->afinidad); return EXIT_FAILURE; }
+    region rc, rd;
+    if (region_adjuntar(&rc, op->control) != 0) { perror("region_adjuntar (control)"); return EXIT_FAILURE; }
+    control *ctl = rc.base;
+    if (op->trabajador >= ctl->n_grupos) { fprintf(stderr, "Trabajador fuera de rango: %d\n", op->trabajador); return EXIT_FAILURE; }
+    trabajo_hijo trabajo = ctl->servidor ? atender_grupo : trabajar_grupo;
+    if (ctl->ruta_archivo[0]) {
+        archivo_notas archivo;
+        if (archivo_abrir(&archivo, ctl->ruta_archivo, !ctl->ventanas) != 0) return EXIT_FAILURE;
+        trabajo(ctl, archivo.notas, archivo.claves, ctl->ventanas ? &archivo : NULL, op->trabajador, &afin);
+        archivo_cerrar(&archivo);
+    } else {
+        region rk = { .fd = -1 };
+        if (region_adjuntar(&rd, ctl->ruta_datos) != 0) { perror("region_adjuntar (datos)"); return EXIT_FAILURE; }
+        if (ctl->agrupar && region_adjuntar(&rk, ctl->ruta_claves) != 0) { perror("region_adjuntar (claves)"); return EXIT_FAILURE; }
+        trabajo(ctl, rd.base, rk.base, NULL, op->trabajador, &afin);
+        region_liberar(&rk, 0);
+        region_liberar(&rd, 0);
+    }
+    region_liberar(&rc, 0);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Crea el hijo del grupo g. Con r->shm se lanza con posix_spawn() y se adjunta
+ * por nombre; si no, se crea con fork() y hereda los mapeos. El hijo ejecuta
+ * trabajo (una corrida o el servidor) y termina. Retorna 0 o -1 si no se pudo crear.
+ */
+static int lanzar_hijo(const recursos *r, int g, trabajo_hijo trabajo)
+{
+    pid_t pid;
+    if (r->shm) {
+        // El trabajador es un programa nuevo: solo conoce los nombres de las regiones
+        char grupo[16];
+        snprintf(grupo, sizeof(grupo), "%d", g);
+        char *args[] = { "procesos_promedio", "--trabajador", grupo, "--control", (char *)r->ruta_control,
+                         "--kernel", (char *)r->kernel, "--afinidad", (char *)r->afinidad, NULL };
+        if (posix_spawn(&pid, "/proc/self/exe", NULL, NULL, args, environ) != 0) {
+            perror("posix_spawn");
+            return -1;
+        }
+    } else {
+        pid = fork(); // Crea un nuevo proceso hijo
+        if (pid < 0) { perror("fork"); return -1; }
         else if (pid == 0) {
-            // Cada hijo procesa su bloque de notas
-            int inicio = g * NOTAS_POR_GRUPO; // Índice inicial de notas para este grupo
-            int fin    = inicio + NOTAS_POR_GRUPO; // Índice final (no inclusivo)
-            long suma = 0;
-            int rep = 0, ab = 0, aa = 0;
-            struct timespec t0g, t1g;
-            clock_gettime(CLOCK_MONOTONIC, &t0g); // Marca de tiempo inicial del grupo
-            for (int i = inicio; i < fin; ++i) {
-                int n = notas[i];
-                suma += n;
-                if (n < 18) rep++;
-                else if (n < 28) ab++;
-                else aa++;
+            trabajo(r->ctl, r->notas, r->claves, r->ventanas, g, r->afin);
+            _exit(0); // Termina el proceso hijo (el sistema libera sus mapeos)
+        }
+    }
+    hijos_agregar(r->hijos, pid);
+    return 0;
+}
+
+/* Lanza los n_grupos hijos; si alguno no se puede crear, mata a los ya lanzados y retorna -1 */
+static int lanzar_hijos(const recursos *r, int n_grupos, trabajo_hijo trabajo)
+{
+    r->hijos->n = 0;
+    atomic_store_explicit(&r->ctl->llegados, 0, memory_order_relaxed);
+    for (int g = 0; g < n_grupos; ++g) {
+        if (lanzar_hijo(r, g, trabajo) != 0) {
+            hijos_matar(r->hijos);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Barrera entre procesos para n participantes */
+static void barrera_compartida(pthread_barrier_t *b, int n)
+{
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(b, &attr, n);
+    pthread_barrierattr_destroy(&attr);
+}
+
+/*
+ * Crea n_grupos hijos sobre las notas compartidas y espera a que terminen.
+ * Con r->shm los hijos se lanzan con posix_spawn() y se adjuntan por nombre;
+ * si no, se crean con fork() y heredan los mapeos.
+ * generar: 1 si cada hijo genera su tramo antes de procesarlo (con semilla).
+ * t0, t1: marcas de inicio y fin del procesamiento (cómputo y reducción, sin la generación).
+ * tiempo_inicio: hora del sistema al comenzar el procesamiento (puede ser NULL).
+ * cst: fallos de página de la corrida (puede ser NULL).
+ * f: duración de cada fase salvo el reporte, que mide quien imprime.
+ * Retorna 0, o -1 si algún hijo no se pudo crear o terminó mal (ya reportado;
+ * los demás quedan muertos y recogidos).
+ */
+static int ejecutar_grupos(const recursos *r, int n_grupos, uint64_t semilla, int generar,
+                            struct timespec *t0, struct timespec *t1, time_t *tiempo_inicio, costos *cst,
+                            fases *f)
+{
+    control *ctl = r->ctl;
+    agregador_iniciar(agregador_de(ctl), r->agregacion, n_grupos, 1); // Totales en cero
+    planificador_iniciar(planificador_de(ctl), r->reparto, n_grupos, r->total - r->desde, r->tam_bloque);
+    ctl->n_grupos = n_grupos;
+    ctl->generar  = generar;
+    ctl->semilla  = semilla;
+    ctl->servidor = 0;
+    ctl->desde    = r->desde;
+    memset(ctl->resultados, 0, sizeof(resultado_por_grupo) * n_grupos);
+
+    // Barrera entre procesos (n_grupos hijos + padre) que separa generación y procesamiento
+    barrera_compartida(&ctl->barrera, n_grupos + 1);
+    if (ctl->agrupar) barrera_compartida(&ctl->barrera_fin, n_grupos); // Mezcla por particiones, solo entre hijos
+
+    long fallos_antes = fallos_menores(RUSAGE_CHILDREN);
+    struct timespec tg0, tl1;
+    clock_gettime(CLOCK_MONOTONIC, &tg0); // Inicio del lanzamiento (y de la generación)
+
+    // Crea n_grupos procesos hijos
+    if (lanzar_hijos(r, n_grupos, trabajar_grupo) != 0) return -1;
+    clock_gettime(CLOCK_MONOTONIC, &tl1); // Fin del lanzamiento
+
+    // Cuando todos los hijos generaron su bloque comienza la medición; la marca se
+    // toma entre las dos esperas para que ningún hijo procese antes de ella. El padre
+    // entra a la barrera recién cuando llegaron todos: si un hijo falla antes, no se queda ahí
+    if (hijos_esperar_llegadas(r->hijos, &ctl->llegados, n_grupos) != 0) return -1;
+    pthread_barrier_wait(&ctl->barrera);
+    clock_gettime(CLOCK_MONOTONIC, t0); // Marca de tiempo alta resolución
+    if (tiempo_inicio) *tiempo_inicio = time(NULL); // Marca de tiempo de inicio (segundos desde epoch)
+    pthread_barrier_wait(&ctl->barrera);
+
+    // Espera a que todos los hijos terminen; si alguno falla, la corrida no vale
+    if (hijos_esperar(r->hijos) != 0) {
+        if (ctl->agrupar) borrar_volcados(ctl);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, t1); // Marca de tiempo final total
+
+    // Inactividad: lo que cada hijo esperó al último en terminar (CLOCK_MONOTONIC es común a todos)
+    resultado_por_grupo *res = ctl->resultados;
+    struct timespec ultimo = res[0].fin;
+    for (int g = 1; g < n_grupos; ++g)
+        if (segundos_entre(ultimo, res[g].fin) > 0) ultimo = res[g].fin;
+    for (int g = 0; g < n_grupos; ++g)
+        res[g].inactivo = segundos_entre(res[g].fin, ultimo);
+    pthread_barrier_destroy(&ctl->barrera);
+    if (ctl->agrupar) pthread_barrier_destroy(&ctl->barrera_fin);
+    agregador_destruir(agregador_de(ctl));
+
+    if (cst) {
+        cst->fallos_hijos   = fallos_menores(RUSAGE_CHILDREN) - fallos_antes;
+        cst->fallos_computo = 0;
+        for (int g = 0; g < n_grupos; ++g)
+            cst->fallos_computo += ctl->resultados[g].fallos;
+    }
+    f->lanzamiento = segundos_entre(tg0, tl1);
+    f->generacion  = segundos_entre(tl1, *t0);
+    f->computo     = segundos_entre(*t0, ultimo);
+    f->reduccion   = segundos_entre(ultimo, *t1);
+    f->reporte     = 0;
+    return 0;
+}
+
+/*
+ * Crea los n_grupos hijos del servidor (--servir), que quedan vivos entre
+ * consultas, y espera a que generen sus tramos. Retorna 0 o -1 si alguno falló.
+ */
+static int servidor_crear(const recursos *r, int n_grupos, uint64_t semilla, int generar)
+{
+    control *ctl = r->ctl;
+    agregador_iniciar(agregador_de(ctl), r->agregacion, n_grupos, 1);
+    planificador_iniciar(planificador_de(ctl), r->reparto, n_grupos, r->total, r->tam_bloque);
+    ctl->n_grupos = n_grupos;
+    ctl->generar  = generar;
+    ctl->semilla  = semilla;
+    ctl->servidor = 1;
+    ctl->salir    = 0;
+    memset(ctl->resultados, 0, sizeof(resultado_por_grupo) * n_grupos);
+    barrera_compartida(&ctl->barrera, n_grupos + 1);
+    barrera_compartida(&ctl->barrera_fin, n_grupos + 1);
+    if (lanzar_hijos(r, n_grupos, atender_grupo) != 0
+        || hijos_esperar_llegadas(r->hijos, &ctl->llegados, n_grupos) != 0) return -1;
+    pthread_barrier_wait(&ctl->barrera_fin); // Todos generaron su tramo
+    return 0;
+}
+
+/* Notas fuera de rango que contaron los hijos (solo puede haber si vienen de un archivo) */
+static long long fuera_de_rango(const control *ctl)
+{
+    long long fuera = 0;
+    for (int g = 0; g < ctl->n_grupos; ++g) fuera += ctl->resultados[g].fuera;
+    return fuera;
+}
+
+/*
+ * Resuelve una consulta con los hijos del servidor (ver atender_consulta):
+ * reparte el rango pedido con el planificador compartido, despierta a los hijos
+ * y espera a que todos terminen. Retorna -1 si algún hijo terminó mal.
+ */
+static int consultar_procesos(void *contexto, const consulta *q, conteo *c)
+{
+    const recursos *r = contexto;
+    control *ctl = r->ctl;
+    planificador_iniciar(planificador_de(ctl), r->reparto, ctl->n_grupos, q->cantidad, r->tam_bloque);
+    agregador_destruir(agregador_de(ctl));
+    agregador_iniciar(agregador_de(ctl), r->agregacion, ctl->n_grupos, 1); // Totales en cero
+    ctl->desde = q->inicio;
+    atomic_store_explicit(&ctl->llegados, 0, memory_order_relaxed);   // Todos esperan en la barrera
+    pthread_barrier_wait(&ctl->barrera);
+    if (hijos_esperar_llegadas(r->hijos, &ctl->llegados, ctl->n_grupos) != 0) return -1;
+    pthread_barrier_wait(&ctl->barrera_fin);
+
+    long long totales[3];
+    agregador_totales(agregador_de(ctl), totales);
+    c->reprobados    = totales[0];
+    c->aprobado_bajo = totales[1];
+    c->aprobado_alto = totales[2];
+    c->suma = 0;
+    for (int g = 0; g < ctl->n_grupos; ++g) {
+        c->suma  += ctl->resultados[g].suma;
+        c->fuera += ctl->resultados[g].fuera;
+    }
+    return 0;
+}
+
+/* Pide a los hijos del servidor que terminen y los espera; retorna -1 si alguno terminó mal */
+static int servidor_destruir(const recursos *r)
+{
+    control *ctl = r->ctl;
+    ctl->salir = 1;
+    pthread_barrier_wait(&ctl->barrera);
+    if (hijos_esperar(r->hijos) != 0) return -1;
+    pthread_barrier_destroy(&ctl->barrera);
+    pthread_barrier_destroy(&ctl->barrera_fin);
+    agregador_destruir(agregador_de(ctl));
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    opciones op;
+    parsear_opciones(argc, argv, &op);
+    if (op.tuberia) {
+        // Los trozos y las colas de la tubería viven en el espacio de un solo proceso
+        fprintf(stderr, "--tuberia solo está disponible en el motor de hilos\n");
+        return EXIT_FAILURE;
+    }
+    if (op.exportar) {
+        // Solo escribe el conjunto de datos generado y termina
+        if (archivo_exportar(op.exportar, op.total, op.semilla, op.secciones) != 0) { perror(op.exportar); return EXIT_FAILURE; }
+        printf("Exportadas %ld notas a %s (semilla %llu)\n", op.total, op.exportar, (unsigned long long)op.semilla);
+        if (op.secciones) printf("Con una clave por nota entre 0 y %u\n", op.secciones - 1);
+        return EXIT_SUCCESS;
+    }
+    const char *kernel = seleccionar_kernel(op.kernel); // Los hijos heredan la selección
+    if (!kernel) { fprintf(stderr, "Kernel no disponible: %s\n", op.kernel); return EXIT_FAILURE; }
+    if (op.trabajador >= 0)
+        return main_trabajador(&op);
+    int n_grupos = op.trabajadores; // Número de procesos hijos
+    static afinidad afin;   // Topología y CPUs para cada hijo
+    if (afinidad_preparar(&afin, op.afinidad) != 0) { fprintf(stderr, "Afinidad inválida: %s\n", op.afinidad); return EXIT_FAILURE; }
+
+    // Bloques del tamaño de la caché repartidos con un cursor atómico en la región de control
+    recursos r = { .agregacion = op.agregacion, .shm = op.shm, .kernel = kernel,
+                   .reparto = op.estatico ? REPARTO_ESTATICO : REPARTO_CURSOR,
+                   .tam_bloque = op.bloque_kib * 1024 / (long)sizeof(nota_t),
+                   .afin = &afin, .afinidad = op.afinidad, .total = op.total };
+    archivo_notas archivo;
+    int generar = 1;        // Las notas se generan salvo que vengan de un archivo
+    if (op.archivo) {
+        // Notas de un archivo: mapeado completo (lo heredan los hijos) o, con --ventana, bloque a bloque
+        if (archivo_abrir(&archivo, op.archivo, op.ventana_mib == 0) != 0) return EXIT_FAILURE;
+        if (op.agrupar && !archivo.con_claves) {
+            fprintf(stderr, "%s: el archivo no trae claves (expórtelo con --secciones)\n", op.archivo);
+            archivo_cerrar(&archivo);
+            return EXIT_FAILURE;
+        }
+        r.total = archivo.cantidad;
+        r.claves = archivo.claves;
+        r.notas = archivo.notas;
+        generar = 0;
+        if (op.ventana_mib) {
+            r.ventanas = &archivo;
+            r.tam_bloque = op.ventana_mib * 1024 * 1024 / (long)sizeof(nota_t);
+        }
+    }
+    // Con una instantánea ya guardada solo se procesan las notas agregadas desde entonces
+    instantanea snap = {0};
+    int incremental = 0;
+    if (op.instantanea) {
+        uint64_t semilla = op.archivo ? archivo.semilla : op.semilla;
+        incremental = instantanea_leer(op.instantanea, &snap, r.total, semilla, op.archivo);
+        if (incremental < 0) return EXIT_FAILURE;
+        if (!incremental) instantanea_crear(&snap, semilla, op.archivo != NULL);
+        r.desde = (long)snap.cab.cantidad;
+    }
+    if (planificador_admite(r.total, r.tam_bloque) != 0) {
+        fprintf(stderr, "Demasiados bloques: %ld notas en bloques de %ld (máximo %u); use bloques mayores\n",
+                r.total, r.tam_bloque, UINT32_MAX);
+        return EXIT_FAILURE;
+    }
+    char nombre_control[64], nombre_datos[64];
+    snprintf(nombre_control, sizeof(nombre_control), "/resumen_global_%d", (int)getpid());
+    snprintf(nombre_datos, sizeof(nombre_datos), "/notas_%d", (int)getpid());
+
+    // Crea la región de control: barrera, un resultado por grupo, el agregador de totales y el planificador
+    region rc, rd;
+    size_t bytes_control = desplazamiento_planificador(n_grupos) + planificador_tamano(n_grupos);
+    if (region_crear(&rc, nombre_control, bytes_control, 0) != 0) {
+        perror("region_crear (control)");
+        return EXIT_FAILURE;
+    }
+    r.ctl = rc.base;
+    hijos h;
+    if (hijos_iniciar(&h, n_grupos) != 0) { perror("malloc"); region_liberar(&rc, 1); return EXIT_FAILURE; }
+    r.hijos = &h;
+    r.ctl->max_grupos = n_grupos;
+    r.ctl->histograma = op.histograma;
+    r.ctl->contadores = op.contadores;
+    r.ctl->agrupar = op.agrupar;
+    r.ctl->secciones = op.archivo ? archivo.secciones : op.secciones ? op.secciones : SECCIONES_DEFECTO;
+    r.ctl->salida = -1;
+    r.ctl->padre = (int)getpid();
+    r.ruta_control = rc.ruta;
+
+    const char *origen_datos;
+    char origen_archivo[4200];
+    if (op.archivo) {
+        // Los hijos lanzados aparte abren el mismo archivo por su ruta
+        snprintf(r.ctl->ruta_archivo, sizeof(r.ctl->ruta_archivo), "%s", op.archivo);
+        r.ctl->ventanas = op.ventana_mib > 0;
+        snprintf(origen_archivo, sizeof(origen_archivo), "archivo %s (%s)", op.archivo,
+                 op.ventana_mib ? "por ventanas" : "mapeado completo");
+        origen_datos = origen_archivo;
+    } else if (op.shm) {
+        // Notas en una región con nombre (páginas enormes si hay) a la que se adjuntan los hijos
+        if (region_crear(&rd, nombre_datos, sizeof(nota_t) * r.total, 1) != 0) {
+            perror("region_crear (datos)");
+            region_liberar(&rc, 1);
+            return EXIT_FAILURE;
+        }
+        r.notas = rd.base;
+        snprintf(r.ctl->ruta_datos, sizeof(r.ctl->ruta_datos), "%s", rd.ruta);
+        origen_datos = rd.enorme ? "memfd con páginas enormes (hugetlbfs)" : "shm_open con THP (madvise)";
+    } else {
+        // Memoria compartida anónima para las notas: cada hijo genera su tramo (primer toque
+        // en su nodo NUMA) y el resto lo ve
+        r.notas = mmap(NULL, sizeof(nota_t) * r.total, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (r.notas == MAP_FAILED) { perror("mmap"); region_liberar(&rc, 1); return EXIT_FAILURE; }
+        origen_datos = "mmap anónimo heredado con fork()";
+    }
+    region rk = { .fd = -1 };
+    if (op.agrupar && !op.archivo) {
+        // Las claves se guardan igual que las notas; cada hijo genera las de su tramo
+        char nombre_claves[64];
+        snprintf(nombre_claves, sizeof(nombre_claves), "/claves_%d", (int)getpid());
+        if (op.shm) {
+            if (region_crear(&rk, nombre_claves, sizeof(clave_t) * r.total, 1) != 0) {
+                perror("region_crear (claves)");
+                return EXIT_FAILURE;
             }
-            clock_gettime(CLOCK_MONOTONIC, &t1g); // Marca de tiempo final del grupo
-            double tiempo = (t1g.tv_sec - t0g.tv_sec) + (t1g.tv_nsec - t0g.tv_nsec) / 1e9;
-            // Llena la estructura resultado_por_grupo con los datos del grupo
-            resultado_por_grupo resultado = { .letra = 'A' + g,
-                              .promedio = (double)suma / NOTAS_POR_GRUPO,
-                              .reprobados = rep,
-                              .aprobado_bajo = ab,
-                              .aprobado_alto = aa,
-                              .tiempo = tiempo };
-
-            // Sección crítica: actualiza los totales globales en memoria compartida
-            sem_wait(semaforo); // Espera el semáforo antes de modificar el recurso compartido
-            resumen_global[0] += rep;
-            resumen_global[1] += ab;
-            resumen_global[2] += aa;
-            sem_post(semaforo); // Libera el semáforo
-
-            // Sección crítica: escribe el resultado del grupo en el archivo
-            sem_wait(semaforo);
-            escribir_resultado("resultados_procesos.txt", &resultado);
-            sem_post(semaforo);
-
-            // Libera recursos antes de terminar el hijo
-            sem_close(semaforo); // Cierra el semáforo
-            munmap(resumen_global, 3 * sizeof(int)); // Libera la memoria compartida
-            close(memoria_compartida); // Cierra el descriptor de la memoria compartida
-            free(notas); // Libera la memoria dinámica
-            _exit(0); // Termina el proceso hijo
+            r.claves = rk.base;
+            snprintf(r.ctl->ruta_claves, sizeof(r.ctl->ruta_claves), "%s", rk.ruta);
+        } else {
+            r.claves = mmap(NULL, sizeof(clave_t) * r.total, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (r.claves == MAP_FAILED) { perror("mmap"); return EXIT_FAILURE; }
         }
     }
-    
-    // Espera a que todos los hijos terminen y luego lee el archivo de resultados
-    while (wait(NULL) > 0); // wait(NULL): espera a que terminen los hijos
-
-    // Escribe los tiempos de inicio y fin en el archivo de resultados
-    clock_gettime(CLOCK_MONOTONIC, &t1); // Marca de tiempo final total
-    double duracion_total = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
-    time_t tiempo_fin = time(NULL); // Marca de tiempo de fin
-    escribir_tiempos_finales("resultados_procesos.txt", duracion_total, tiempo_inicio, tiempo_fin, t0, t1);
-
-    printf("\n=== PROCESOS ===\n")
-    // Imprime solo las primeras 8 líneas del archivo de resultados
-    FILE *out = fopen("resultados_hilos.txt", "r");
-    if (out) {
-        char line[256];
-        int count = 0;
-        while (fgets(line, sizeof line, out) && count < 8) {
-            printf("%s", line);
-            count++;
+    // Los hijos heredan el descriptor de la salida (con fork y con posix_spawn)
+    if (op.salida_grupos && (r.ctl->salida = grupos_abrir_salida(op.salida_grupos)) < 0) return EXIT_FAILURE;
+
+    struct timespec t0, t1;
+    costos cst;
+    fases f;
+    int error = 0;
+    if (op.servir) {
+        // Los hijos y las notas se crean una vez; después solo se atienden consultas
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (servidor_crear(&r, n_grupos, op.semilla, generar) != 0) { error = 1; goto liberar; }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(stderr, "Grupo de %d procesos listo en %.6f segundos (%s y %s)\n", n_grupos,
+                segundos_entre(t0, t1), op.shm ? "posix_spawn" : "fork", generar ? "generación" : "mapeo");
+        error = servir(op.socket, r.total, consultar_procesos, &r, "PROCESOS") != 0;
+        // Si una consulta falló, los hijos ya están muertos y recogidos
+        if (hijos_vivos(&h) && servidor_destruir(&r) != 0) error = 1;
+    } else if (op.barrido) {
+        // Genera una sola vez con todos los procesos y mide cada nivel sobre los mismos datos
+        if (ejecutar_grupos(&r, n_grupos, op.semilla, generar, &t0, &t1, NULL, NULL, &f) != 0 ||
+            archivo_fuera_de_rango(op.archivo, fuera_de_rango(r.ctl)) != 0) { error = 1; goto liberar; }
+        double duracion_generacion = f.generacion;
+        int niveles[33];
+        double tiempos[33], esperas[33];
+        int n_niveles = barrido_niveles(n_grupos, niveles);
+        for (int i = 0; i < n_niveles; ++i) {
+            if (ejecutar_grupos(&r, niveles[i], op.semilla, 0, &t0, &t1, NULL, NULL, &f) != 0) { error = 1; goto liberar; }
+            tiempos[i] = segundos_entre(t0, t1);
+            esperas[i] = agregador_espera_maxima(agregador_de(r.ctl));
         }
-        fclose(out);
-    }
-
-    // Imprime los totales globales acumulados en memoria compartida
-    printf("\n=== Totales Globales ===\n");
-    printf("Reprobados: %d\n", resumen_global[0]);
-    printf("Aprobados (18-27.99): %d\n", resumen_global[1]);
-    printf("Aprobados (28-40): %d\n", resumen_global[2]);
-    munmap(resumen_global, 3 * sizeof(int)); // Libera memoria compartida
-    close(memoria_compartida); // Cierra descriptor de memoria compartida
-    shm_unlink("/resumen_global"); // Elimina el objeto de memoria compartida
-
-    clock_gettime(CLOCK_MONOTONIC, &t1); // Marca de tiempo final total
-    duracion_total = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
-    tiempo_fin = time(NULL); // Marca de tiempo de fin
-
-    // Imprime el tiempo total de ejecución
-    printf("\n=== Resumen (PROCESOS) ===\n");
-    char buf_inicio[64], buf_fin[64];
-    strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&tiempo_inicio));
-    strftime(buf_fin, sizeof(buf_fin), "%a %b %d %H:%M:%S", localtime(&tiempo_fin));
-    printf("Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&tiempo_inicio)->tm_year);
-    printf("Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&tiempo_fin)->tm_year);
-    printf("Duración total: %.6f segundos\n", duracion_total);
-
-    sem_close(semaforo);      // Cierra el semáforo
-    sem_unlink(SEM_NAME);// Elimina el semáforo del sistema
-    free(notas);         // Libera la memoria dinámica
-    return EXIT_SUCCESS;
+        barrido_imprimir("PROCESOS", niveles, tiempos, esperas, n_niveles);
+        if (generar)
+            printf("Generación: %.6f segundos (semilla %llu)\n", duracion_generacion, (unsigned long long)op.semilla);
+    } else {
+        time_t tiempo_inicio;
+        // Si un hijo falló o el archivo trae notas fuera de rango no se reporta ni se registra nada
+        if (ejecutar_grupos(&r, n_grupos, op.semilla, generar, &t0, &t1, &tiempo_inicio, &cst, &f) != 0 ||
+            archivo_fuera_de_rango(op.archivo, fuera_de_rango(r.ctl)) != 0) {
+            error = 1;
+            goto liberar;
+        }
+        double duracion_generacion = f.generacion;
+
+        double duracion_total = segundos_entre(t0, t1);
+        time_t tiempo_fin = time(NULL); // Marca de tiempo de fin
+
+        // Los hijos dejaron sus resultados en memoria compartida: se imprimen desde ahí
+        // y el historial se escribe una sola vez al final
+        const resultado_por_grupo *res = r.ctl->resultados;
+        // Histograma global: mezcla de los 41 contadores de cada hijo
+        histograma hist = {0};
+        if (op.histograma)
+            for (int g = 0; g < n_grupos; ++g) histograma_sumar(&hist, &res[g].hist);
+        long long resumen_global[3];
+        agregador *totales = agregador_de(r.ctl);
+        agregador_totales(totales, resumen_global);
+        long base = r.desde;
+        correcciones corr = {0};   // Se escriben en el archivo recién con la instantánea guardada
+        if (op.instantanea) {
+            // Lo procesado se pliega en la instantánea y los totales pasan a ser los de todas las notas
+            for (int g = 0; g < n_grupos; ++g) instantanea_plegar(&snap, &res[g].hist);
+            instantanea_avanzar(&snap, r.total);
+            if (op.correcciones && instantanea_corregir(&snap, op.correcciones, op.archivo, &corr) != 0) {
+                error = 1;
+                goto liberar;
+            }
+            instantanea_total(&snap, &hist);
+            conteo c = {0};
+            histograma_conteo(&hist, &c);
+            resumen_global[0] = c.reprobados;
+            resumen_global[1] = c.aprobado_bajo;
+            resumen_global[2] = c.aprobado_alto;
+        }
+        registro_grupo *grupos = malloc(sizeof(registro_grupo) * n_grupos);
+        medicion_hw *mediciones = malloc(sizeof(medicion_hw) * n_grupos); // Copia: --verificar reutiliza res
+        if (!grupos || !mediciones) { perror("malloc"); exit(EXIT_FAILURE); }
+        printf("\n=== PROCESOS ===\n");
+        for (int g = 0; g < n_grupos; ++g) {
+            mediciones[g] = res[g].hw;
+            grupos[g] = (registro_grupo){ .promedio = res[g].promedio, .reprobados = res[g].reprobados,
+                                          .aprobado_bajo = res[g].aprobado_bajo, .aprobado_alto = res[g].aprobado_alto,
+                                          .cantidad = res[g].cantidad, .tiempo = res[g].tiempo, .espera = res[g].espera,
+                                          .bloques = res[g].bloques, .inactivo = res[g].inactivo, .cpu = res[g].cpu,
+                                          .hw = op.contadores ? &mediciones[g] : NULL };
+            memcpy(grupos[g].etiqueta, res[g].etiqueta, ETIQUETA_MAX);
+            registro_imprimir_grupo(stdout, &grupos[g]);
+        }
+
+        // Imprime los totales globales acumulados en memoria compartida
+        printf("\n=== Totales Globales (%s) ===\n", agregacion_nombre(totales->modo));
+        printf("Reprobados: %lld\n", resumen_global[0]);
+        printf("Aprobados (18-27.99): %lld\n", resumen_global[1]);
+        printf("Aprobados (28-40): %lld\n", resumen_global[2]);
+        agregador_imprimir_esperas(totales);
+        if (op.histograma) histograma_imprimir(&hist, op.cortes, op.n_cortes);
+        // Agrupación por clave: cada hijo mezcló y resumió una partición
+        resumen_grupos agrupacion = {0};
+        if (op.agrupar) {
+            for (int g = 0; g < n_grupos; ++g) grupos_combinar(&agrupacion, &res[g].grupos);
+            grupos_imprimir(&agrupacion, n_grupos, op.salida_grupos);
+        }
+
+        // Imprime el tiempo total de ejecución
+        printf("\n=== Resumen (PROCESOS) ===\n");
+        char buf_inicio[64], buf_fin[64];
+        strftime(buf_inicio, sizeof(buf_inicio), "%a %b %d %H:%M:%S", localtime(&tiempo_inicio));
+        strftime(buf_fin, sizeof(buf_fin), "%a %b %d %H:%M:%S", localtime(&tiempo_fin));
+        printf("Inicio: %s:%09ld %d\n", buf_inicio, t0.tv_nsec, 1900 + localtime(&tiempo_inicio)->tm_year);
+        printf("Fin: %s:%09ld %d\n", buf_fin, t1.tv_nsec, 1900 + localtime(&tiempo_fin)->tm_year);
+        printf("Duración total: %.6f segundos\n", duracion_total);
+        printf("Ancho de banda: %.2f GB/s (kernel %s, %zu byte(s) por nota)\n",
+               gbps(r.total - r.desde, duracion_total), kernel, sizeof(nota_t));
+        if (generar)
+            printf("Generación: %.6f segundos (semilla %llu)\n", duracion_generacion, (unsigned long long)op.semilla);
+        printf("Reparto: %s, %ld bloques de %ld KiB\n", reparto_nombre(r.reparto),
+               planificador_de(r.ctl)->n_bloques, r.tam_bloque * (long)sizeof(nota_t) / 1024);
+
+        // Ancho de banda por nodo NUMA según la CPU donde terminó cada hijo
+        int *cpus = malloc(sizeof(int) * n_grupos);
+        long *cantidades = malloc(sizeof(long) * n_grupos);
+        double *tiempos = malloc(sizeof(double) * n_grupos);
+        if (!cpus || !cantidades || !tiempos) { perror("malloc"); exit(EXIT_FAILURE); }
+        for (int g = 0; g < n_grupos; ++g) {
+            cpus[g] = r.ctl->resultados[g].cpu;
+            cantidades[g] = r.ctl->resultados[g].cantidad;
+            tiempos[g] = r.ctl->resultados[g].tiempo;
+        }
+        afinidad_imprimir_nodos(&afin, cpus, cantidades, tiempos, n_grupos);
+        if (op.contadores) contadores_imprimir(mediciones, cantidades, n_grupos);
+        free(cpus);
+        free(cantidades);
+        free(tiempos);
+
+        // Costos de crear a los hijos, separados del cómputo
+        printf("\n=== Costos de lanzamiento (PROCESOS) ===\n");
+        printf("Datos: %s\n", origen_datos);
+        printf("Lanzamiento (%s): %.6f segundos\n", op.shm ? "posix_spawn" : "fork", f.lanzamiento);
+        printf("Fallos de página menores de los hijos: %ld (durante el cómputo: %ld)\n",
+               cst.fallos_hijos, cst.fallos_computo);
+
+        // El reporte va desde el fin de la reducción hasta aquí
+        struct timespec t_reporte;
+        clock_gettime(CLOCK_MONOTONIC, &t_reporte);
+        f.reporte = segundos_entre(t1, t_reporte);
+        printf("\n");
+        imprimir_fases(&f);
+
+        if (op.instantanea) {
+            instantanea_imprimir(&snap, op.instantanea, base, corr.n, duracion_total);
+            if (op.verificar) {
+                // Recálculo completo con los mismos procesos sobre todas las notas; el archivo
+                // todavía no tiene las correcciones, así que se le aplican al resultado
+                recursos completo = r;
+                completo.desde = 0;
+                struct timespec v0, v1;
+                fases fv;
+                histograma recalculado = {0};
+                if (ejecutar_grupos(&completo, n_grupos, op.semilla, generar, &v0, &v1, NULL, NULL, &fv) != 0) {
+                    error = 1;
+                } else {
+                    for (int g = 0; g < n_grupos; ++g) histograma_sumar(&recalculado, &res[g].hist);
+                    correcciones_aplicar(&corr, &recalculado);
+                    if (instantanea_verificar(&hist, &recalculado, duracion_total, segundos_entre(v0, v1)) != 0)
+                        error = 1;
+                }
+            }
+            // Si no coincide se conservan la instantánea anterior y el archivo sin corregir
+            if (!error && instantanea_guardar(op.instantanea, &snap, op.archivo, &corr) != 0) {
+                perror(op.instantanea);
+                error = 1;
+            }
+            if (!error && corr.n > 0
+                && instantanea_escribir_correcciones(&snap, op.instantanea, &corr, op.archivo) != 0)
+                error = 1;
+            correcciones_liberar(&corr);
+        }
+
+        if (op.historial) {
+            registro_corrida reg = { .motor = "procesos", .kernel = kernel, .agregacion = agregacion_nombre(totales->modo),
+                                     .reparto = reparto_nombre(r.reparto), .afinidad = op.afinidad,
+                                     .datos = op.archivo ? op.archivo : "generadas", .semilla = op.semilla,
+                                     .trabajadores = n_grupos, .total = r.total,
+                                     .bloque_kib = r.tam_bloque * (long)sizeof(nota_t) / 1024,
+                                     .inicio = tiempo_inicio, .duracion = duracion_total, .f = f,
+                                     .totales = { resumen_global[0], resumen_global[1], resumen_global[2] },
+                                     .hist = op.histograma ? &hist : NULL,
+                                     .agrupacion = op.agrupar ? &agrupacion : NULL,
+                                     .n_grupos = n_grupos, .grupos = grupos };
+            if (registro_agregar(op.historial, &reg) != 0) perror(op.historial);
+        }
+        free(grupos);
+        free(mediciones);
+    }
+
+liberar:
+    if (r.ctl->salida >= 0) close(r.ctl->salida);
+    if (op.archivo) archivo_cerrar(&archivo);
+    else if (op.shm) region_liberar(&rd, 1);
+    else munmap(r.notas, sizeof(nota_t) * r.total); // Libera el mapeo de notas
+    if (op.agrupar && !op.archivo) {
+        if (op.shm) region_liberar(&rk, 1);
+        else munmap(r.claves, sizeof(clave_t) * r.total);
+    }
+    hijos_liberar(&h);
+    region_liberar(&rc, 1);   // Libera y elimina la región de control
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,142 @@
+#define _GNU_SOURCE   /* open_memstream */
+#include "registro.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+/* Datos de la máquina que se repiten en cada registro */
+typedef struct {
+    char host[256];
+    char sistema[200];    // "Linux 6.8.0 x86_64"
+    char fecha[32];       // Inicio del cómputo en ISO 8601 (UTC)
+    long cpus;            // Núcleos lógicos en línea
+} maquina;
+
+static void describir_maquina(const registro_corrida *r, maquina *m)
+{
+    if (gethostname(m->host, sizeof(m->host)) != 0) strcpy(m->host, "desconocido");
+    m->host[sizeof(m->host) - 1] = '\0';
+    struct utsname u;
+    if (uname(&u) == 0) snprintf(m->sistema, sizeof(m->sistema), "%s %s %s", u.sysname, u.release, u.machine);
+    else strcpy(m->sistema, "desconocido");
+    struct tm tm;
+    gmtime_r(&r->inicio, &tm);
+    strftime(m->fecha, sizeof(m->fecha), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    m->cpus = sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+/* Cadena JSON entre comillas, escapando comillas, barras y caracteres de control */
+static void json_cadena(FILE *s, const char *texto)
+{
+    fputc('"', s);
+    for (const unsigned char *p = (const unsigned char *)texto; *p; ++p) {
+        if (*p == '"' || *p == '\\') fprintf(s, "\\%c", *p);
+        else if (*p < 0x20) fprintf(s, "\\u%04x", *p);
+        else fputc(*p, s);
+    }
+    fputc('"', s);
+}
+
+/* Una línea JSON con la corrida completa */
+static void escribir_json(FILE *s, const registro_corrida *r, const maquina *m)
+{
+    fprintf(s, "{\"motor\":");
+    json_cadena(s, r->motor);
+    fprintf(s, ",\"fecha\":\"%s\",\"host\":", m->fecha);
+    json_cadena(s, m->host);
+    fprintf(s, ",\"sistema\":");
+    json_cadena(s, m->sistema);
+    fprintf(s, ",\"cpus\":%ld,\"semilla\":%llu,\"trabajadores\":%d,\"total\":%ld,\"bytes_por_nota\":%zu",
+            m->cpus, (unsigned long long)r->semilla, r->trabajadores, r->total, sizeof(nota_t));
+    if (r->procesos) fprintf(s, ",\"procesos\":%d", r->procesos);
+    fprintf(s, ",\"kernel\":");
+    json_cadena(s, r->kernel);
+    fprintf(s, ",\"agregacion\":");
+    json_cadena(s, r->agregacion);
+    fprintf(s, ",\"reparto\":");
+    json_cadena(s, r->reparto);
+    fprintf(s, ",\"bloque_kib\":%ld,\"afinidad\":", r->bloque_kib);
+    json_cadena(s, r->afinidad);
+    fprintf(s, ",\"datos\":");
+    json_cadena(s, r->datos);
+    fprintf(s, ",\"duracion\":%.9f", r->duracion);
+    fprintf(s, ",\"fases\":{\"lanzamiento\":%.9f,\"generacion\":%.9f,\"computo\":%.9f,\"reduccion\":%.9f,\"reporte\":%.9f}",
+            r->f.lanzamiento, r->f.generacion, r->f.computo, r->f.reduccion, r->f.reporte);
+    fprintf(s, ",\"totales\":{\"reprobados\":%lld,\"aprobado_bajo\":%lld,\"aprobado_alto\":%lld}",
+            r->totales[0], r->totales[1], r->totales[2]);
+    if (r->hist) {
+        fprintf(s, ",\"histograma\":[");
+        for (int k = 0; k < N_CLASES; ++k) fprintf(s, "%s%lld", k ? "," : "", r->hist->cuenta[k]);
+        fprintf(s, "],\"fuera_de_rango\":%lld", r->hist->fuera);
+    }
+    if (r->agrupacion) {
+        const resumen_grupos *g = r->agrupacion;
+        fprintf(s, ",\"agrupacion\":{\"claves\":%ld,\"notas\":%lld,\"particiones\":%d,\"filas_locales\":%ld,"
+                   "\"descartadas\":%lld,\"local\":%.9f,\"mezcla\":%.9f}",
+                g->claves, g->notas, r->trabajadores, g->filas_locales, g->descartadas, g->local, g->mezcla);
+    }
+    fprintf(s, ",\"grupos\":[");
+    for (int i = 0; i < r->n_grupos; ++i) {
+        const registro_grupo *g = &r->grupos[i];
+        fprintf(s, "%s{\"grupo\":\"%s\",\"promedio\":%.6f,\"reprobados\":%lld,\"aprobado_bajo\":%lld,"
+                   "\"aprobado_alto\":%lld,\"cantidad\":%ld,\"tiempo\":%.9f,\"gbps\":%.3f,\"espera\":%.9f,"
+                   "\"bloques\":%d,\"inactivo\":%.9f,\"cpu\":%d",
+                i ? "," : "", g->etiqueta, g->promedio, g->reprobados, g->aprobado_bajo, g->aprobado_alto,
+                g->cantidad, g->tiempo, gbps(g->cantidad, g->tiempo), g->espera, g->bloques, g->inactivo, g->cpu);
+        if (g->hw) {
+            // Los eventos no disponibles quedan en -1
+            const medicion_hw *h = g->hw;
+            fprintf(s, ",\"contadores\":{\"ciclos\":%lld,\"instrucciones\":%lld,\"fallos_llc\":%lld,"
+                       "\"fallos_rama\":%lld,\"fallos_dtlb\":%lld,\"fallos_menores\":%ld,\"fallos_mayores\":%ld,"
+                       "\"cambios_voluntarios\":%ld,\"cambios_involuntarios\":%ld}",
+                    h->hw[HW_CICLOS], h->hw[HW_INSTRUCCIONES], h->hw[HW_FALLOS_LLC], h->hw[HW_FALLOS_RAMA],
+                    h->hw[HW_FALLOS_DTLB], h->fallos_menores, h->fallos_mayores, h->cambios_voluntarios,
+                    h->cambios_involuntarios);
+        }
+        fputc('}', s);
+    }
+    fprintf(s, "]}\n");
+}
+
+void registro_imprimir_grupo(FILE *salida, const registro_grupo *g)
+{
+    fprintf(salida,
+            "Grupo %s | Promedio: %.2f | Reprobados: %lld | Aprobados (18-27.99): %lld | Aprobados (28-40): %lld | Tiempo: %.6f s | %.2f GB/s | Espera agregación: %.3f us | Bloques: %d | Inactivo: %.3f ms\n",
+            g->etiqueta, g->promedio, g->reprobados, g->aprobado_bajo, g->aprobado_alto, g->tiempo,
+            gbps(g->cantidad, g->tiempo), 1e6 * g->espera, g->bloques, 1e3 * g->inactivo);
+}
+
+int registro_agregar(const char *ruta, const registro_corrida *r)
+{
+    int fd = open(ruta, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return -1;
+
+    // El registro se arma en memoria y se escribe de una vez al final del archivo
+    maquina m;
+    describir_maquina(r, &m);
+    char *texto = NULL;
+    size_t bytes = 0;
+    FILE *s = open_memstream(&texto, &bytes);
+    if (!s) { close(fd); return -1; }
+    escribir_json(s, r, &m);
+    fclose(s);
+
+    size_t escritos = 0;
+    while (escritos < bytes) {
+        ssize_t n = write(fd, texto + escritos, bytes - escritos);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        escritos += (size_t)n;
+    }
+    int error = errno;
+    free(texto);
+    close(fd);
+    if (escritos < bytes) { errno = error; return -1; }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "agrupacion.h"
+#include "comun.h"
+#include "contadores.h"
+#include "histograma.h"
+
+#define HISTORIAL_NINGUNO "ninguno"   // --historial ninguno: no se registra la corrida (anula uno anterior)
+
+/* Resultado de un grupo tal como se imprime y se registra (igual en ambos motores) */
+typedef struct {
+    char etiqueta[ETIQUETA_MAX];
+    double promedio;
+    long long reprobados;
+    long long aprobado_bajo;
+    long long aprobado_alto;
+    long cantidad;        // Notas procesadas
+    double tiempo;        // Segundos de cómputo del grupo
+    double espera;        // Segundos en la agregación de totales globales
+    int bloques;          // Bloques procesados
+    double inactivo;      // Segundos sin trabajo
+    int cpu;              // CPU en la que terminó
+    const medicion_hw *hw; // Contadores del bucle del grupo (--contadores) o NULL
+} registro_grupo;
+
+/* Todo lo que describe una corrida: configuración, fases, totales y grupos */
+typedef struct {
+    const char *motor;        // "hilos", "procesos" o "hibrido"
+    const char *kernel;       // Kernel de clasificación usado
+    const char *agregacion;   // Modo de los totales globales
+    const char *reparto;      // Reparto de bloques
+    const char *afinidad;     // Política de afinidad
+    const char *datos;        // "generadas" o la ruta del archivo de notas
+    uint64_t semilla;
+    int trabajadores;
+    int procesos;             // Procesos entre los que se reparten los trabajadores (solo el híbrido; 0 si no)
+    long total;               // Notas procesadas
+    long bloque_kib;          // Tamaño de bloque del planificador
+    time_t inicio;            // Hora del sistema al comenzar el cómputo
+    double duracion;          // Cómputo + reducción ("Duración total")
+    fases f;
+    long long totales[3];     // Reprobados, aprobados bajos y aprobados altos
+    const histograma *hist;   // Histograma mezclado (--histograma) o NULL
+    const resumen_grupos *agrupacion; // Resumen de --agrupar (una partición por trabajador) o NULL
+    int n_grupos;
+    const registro_grupo *grupos;
+} registro_corrida;
+
+/*
+ * Imprime la línea de un grupo con el formato de siempre
+ * ("Grupo A | Promedio: ... | Inactivo: ... ms").
+ */
+void registro_imprimir_grupo(FILE *salida, const registro_grupo *g);
+
+/*
+ * Agrega la corrida al final del historial en ruta, en una sola escritura con
+ * O_APPEND (corridas simultáneas no se mezclan y no se lee el archivo): una
+ * línea JSON por corrida con los grupos en un arreglo (y el histograma, el
+ * resumen de la agrupación por clave y los contadores de cada grupo, si los hay).
+ * Retorna 0 o -1 (con errno).
+ */
+int registro_agregar(const char *ruta, const registro_corrida *r);
+
+#endif
@@ -1,81 +1,413 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <getopt.h>
+#include <spawn.h>
+#include <unistd.h>
 #include <sys/wait.h>
-#include <float.h>
+
+#include "estadistica.h"
+#include "registro.h"
+
+extern char **environ;
+
+#define N_FASES 5
+static const char *nombres_fase[N_FASES] = { "lanzamiento", "generacion", "computo", "reduccion", "reporte" };
+
+/* Motor a medir y las muestras que se van juntando */
+typedef struct {
+    const char *titulo;   // "Procesos", "Hilos" o la disposición del híbrido
+    const char *nombre;   // Valor del campo "motor" en el historial
+    const char *ruta;     // Ejecutable a lanzar
+    int procesos, hilos;  // Disposición P×T del híbrido (0 en los demás motores)
+    char *args[4];        // Opciones propias del motor, después de las comunes
+    int n_args;
+    char texto[3][32];    // Título, P y P×T del híbrido (args y titulo apuntan aquí)
+    double *muestras;     // Métrica elegida por repetición
+    double *por_fase[N_FASES]; // Cada fase por repetición
+    int n;                // Repeticiones medidas
+    int capacidad;        // Muestras que caben en los arreglos
+} motor;
+
+#define MAX_FILTROS 16
+#define MAX_DISPOSICIONES 32
+#define MAX_MOTORES (2 + MAX_DISPOSICIONES)
+
+/*
+ * Prepara m como el motor híbrido con P procesos de T hilos: se lanza con
+ * --procesos P --trabajadores P×T, que van después de las opciones comunes.
+ */
+static void motor_hibrido(motor *m, int p, int t)
+{
+    *m = (motor){ .nombre = "hibrido", .ruta = "./hibrido_promedio", .procesos = p, .hilos = t, .n_args = 4 };
+    snprintf(m->texto[0], sizeof(m->texto[0]), "Hibrido %dx%d", p, t);
+    snprintf(m->texto[1], sizeof(m->texto[1]), "%d", p);
+    snprintf(m->texto[2], sizeof(m->texto[2]), "%d", p * t);
+    m->titulo = m->texto[0];
+    m->args[0] = "--procesos";
+    m->args[1] = m->texto[1];
+    m->args[2] = "--trabajadores";
+    m->args[3] = m->texto[2];
+}
 
 /*
- * Función lanzar: ejecuta un comando externo usando system().
- * cmd: cadena con el comando a ejecutar (ej: "./procesos_promedio")
- * Imprime advertencias si el comando termina con error.
+ * Agrega a motores las disposiciones de texto ("2x4,4x2,8x1"). Sin texto usa
+ * todas las que ocupan exactamente los núcleos en línea (1xN, 2xN/2, ..., Nx1).
+ * Retorna la nueva cantidad de motores o -1 si alguna no es válida.
  */
-static void lanzar(const char *cmd)
+static int agregar_disposiciones(motor *motores, int n, const char *texto)
 {
-    printf("\n===== Lanzando %s =====\n", cmd);
-    int status = system(cmd); // Ejecuta el comando externo
-    if (status == -1) {
-        perror("system");
-    } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
-        fprintf(stderr, "\u26A0\uFE0F  %s terminó con código %d\n", cmd, WEXITSTATUS(status));
+    if (!texto) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus < 1) cpus = 1;
+        for (int p = 1; p <= cpus && n < MAX_MOTORES; ++p)
+            if (cpus % p == 0) motor_hibrido(&motores[n++], p, (int)(cpus / p));
+        return n;
     }
+    for (const char *d = texto; *d; ) {
+        int p, t, leidos;
+        if (n == MAX_MOTORES || sscanf(d, "%dx%d%n", &p, &t, &leidos) != 2 || p < 1 || t < 1) return -1;
+        motor_hibrido(&motores[n++], p, t);
+        d += leidos;
+        if (*d == ',') d++;
+        else if (*d) return -1;
+    }
+    return n;
 }
 
 /*
- * Función extraer_tiempo: busca y extrae el tiempo total desde un archivo de resultados.
- * filename: nombre del archivo a leer (ej: "resultados_procesos.txt")
- * Retorna el tiempo en segundos (double) o -1 si no se encuentra.
+ * Valor de la métrica elegida: una fase o "total" (cómputo + reducción,
+ * lo que los motores reportan como "Duración total").
  */
-static double extraer_tiempo(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return -1;
-    char line[256];
-    double tiempo = -1;
-    while (fgets(line, sizeof(line), f)) {
-        if (strstr(line, "Duración total")) {
-            sscanf(line, "%*[^:]: %lf", &tiempo); // Extrae el número después de ':'
-            break;
+static double metrica(const double f[N_FASES], int fase)
+{
+    return fase < 0 ? f[2] + f[3] : f[fase];
+}
+
+/* Agrega una muestra (sus fases y la métrica elegida) al motor, agrandando los arreglos si hace falta */
+static void agregar_muestra(motor *m, const double f[N_FASES], int fase)
+{
+    if (m->n == m->capacidad) {
+        m->capacidad = m->capacidad ? 2 * m->capacidad : 16;
+        m->muestras = realloc(m->muestras, sizeof(double) * m->capacidad);
+        if (!m->muestras) { perror("realloc"); exit(EXIT_FAILURE); }
+        for (int k = 0; k < N_FASES; ++k) {
+            m->por_fase[k] = realloc(m->por_fase[k], sizeof(double) * m->capacidad);
+            if (!m->por_fase[k]) { perror("realloc"); exit(EXIT_FAILURE); }
         }
     }
-    fclose(f);
-    return tiempo;
+    m->muestras[m->n] = metrica(f, fase);
+    for (int k = 0; k < N_FASES; ++k) m->por_fase[k][m->n] = f[k];
+    m->n++;
+}
+
+/*
+ * Indica si la línea JSON tiene el campo clave=valor de un filtro, sea número
+ * ("clave":valor) o cadena ("clave":"valor").
+ */
+static int cumple_filtro(const char *linea, const char *filtro)
+{
+    const char *igual = strchr(filtro, '=');
+    if (!igual) return 0;
+    char patron[256];
+    int largo = snprintf(patron, sizeof(patron), "\"%.*s\":", (int)(igual - filtro), filtro);
+    if (largo >= (int)sizeof(patron)) return 0;
+    const char *valor = igual + 1;
+    size_t n = strlen(valor);
+    for (const char *p = strstr(linea, patron); p; p = strstr(p + 1, patron)) {
+        const char *v = p + largo;
+        if (*v == '"' && strncmp(v + 1, valor, n) == 0 && v[n + 1] == '"') return 1;
+        if (strncmp(v, valor, n) == 0 && (v[n] == ',' || v[n] == '}')) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Carga las corridas del historial JSON Lines que escriben los motores (--historial):
+ * cada línea cuyo "motor" esté entre los elegidos (para el híbrido, además con su
+ * misma disposición) y que cumpla todos los filtros aporta una muestra con sus
+ * fases. Retorna las líneas usadas o -1 si no se pudo abrir.
+ */
+static int cargar_historial(const char *ruta, motor *motores, int n_motores, int fase,
+                            char **filtros, int n_filtros)
+{
+    FILE *historial = fopen(ruta, "r");
+    if (!historial) { perror(ruta); return -1; }
+    char *linea = NULL;
+    size_t tam = 0;
+    int usadas = 0;
+    while (getline(&linea, &tam, historial) > 0) {
+        char nombre[32];
+        const char *fases_json = strstr(linea, "\"fases\":{");
+        if (sscanf(linea, "{\"motor\":\"%31[^\"]\"", nombre) != 1 || !fases_json) continue;
+        double f[N_FASES];
+        if (sscanf(fases_json, "\"fases\":{\"lanzamiento\":%lf,\"generacion\":%lf,\"computo\":%lf,\"reduccion\":%lf,\"reporte\":%lf",
+                   &f[0], &f[1], &f[2], &f[3], &f[4]) != N_FASES) continue;
+        int cumple = 1;
+        for (int i = 0; i < n_filtros && cumple; ++i) cumple = cumple_filtro(linea, filtros[i]);
+        if (!cumple) continue;
+        for (int e = 0; e < n_motores; ++e) {
+            if (strcasecmp(nombre, motores[e].nombre) != 0) continue;
+            if (motores[e].procesos) {
+                char procesos[48], trabajadores[48];
+                snprintf(procesos, sizeof(procesos), "procesos=%s", motores[e].texto[1]);
+                snprintf(trabajadores, sizeof(trabajadores), "trabajadores=%s", motores[e].texto[2]);
+                if (!cumple_filtro(linea, procesos) || !cumple_filtro(linea, trabajadores)) continue;
+            }
+            agregar_muestra(&motores[e], f, fase);
+            usadas++;
+        }
+    }
+    free(linea);
+    fclose(historial);
+    return usadas;
+}
+
+/*
+ * Función lanzar: ejecuta un motor con posix_spawn() y lee su salida por una tubería.
+ * m: motor a ejecutar.
+ * extra, n_extra: opciones que se pasan tal cual al motor (antes de las suyas propias).
+ * calentamiento: 1 para agregar --historial ninguno y no registrar la corrida
+ * (la última opción prevalece).
+ * mostrar: 1 para reenviar la salida del motor a la consola.
+ * f: duración de cada fase leída de la línea "Fases (s):" del motor.
+ * Retorna 0 si el motor terminó bien y reportó sus fases, -1 si no.
+ */
+static int lanzar(const motor *m, char **extra, int n_extra, int calentamiento, int mostrar, double f[N_FASES])
+{
+    int tubo[2];
+    if (pipe(tubo) != 0) { perror("pipe"); return -1; }
+    char **args = malloc(sizeof(char *) * (n_extra + m->n_args + 4));
+    if (!args) { perror("malloc"); exit(EXIT_FAILURE); }
+    int n = 0;
+    args[n++] = (char *)m->ruta;
+    for (int i = 0; i < n_extra; ++i) args[n++] = extra[i];
+    for (int i = 0; i < m->n_args; ++i) args[n++] = m->args[i];
+    if (calentamiento) {
+        args[n++] = "--historial";
+        args[n++] = HISTORIAL_NINGUNO;
+    }
+    args[n] = NULL;
+
+    // La salida estándar del motor va a la tubería; el error estándar se hereda
+    posix_spawn_file_actions_t acciones;
+    posix_spawn_file_actions_init(&acciones);
+    posix_spawn_file_actions_adddup2(&acciones, tubo[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&acciones, tubo[0]);
+    posix_spawn_file_actions_addclose(&acciones, tubo[1]);
+    pid_t pid;
+    int error = posix_spawn(&pid, m->ruta, &acciones, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&acciones);
+    free(args);
+    close(tubo[1]);
+    if (error != 0) {
+        fprintf(stderr, "❌  No se pudo lanzar %s: %s\n", m->ruta, strerror(error));
+        close(tubo[0]);
+        return -1;
+    }
+
+    FILE *salida = fdopen(tubo[0], "r");
+    char line[1024];
+    int leidas = 0;
+    while (fgets(line, sizeof(line), salida)) {
+        if (mostrar) fputs(line, stdout);
+        if (strncmp(line, "Fases (s):", 10) == 0)
+            leidas = sscanf(line, "Fases (s): lanzamiento=%lf generacion=%lf computo=%lf reduccion=%lf reporte=%lf",
+                            &f[0], &f[1], &f[2], &f[3], &f[4]);
+    }
+    fclose(salida);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "⚠️  %s terminó con código %d\n", m->ruta, WEXITSTATUS(status));
+        return -1;
+    }
+    if (leidas != N_FASES) {
+        fprintf(stderr, "⚠️  %s no reportó sus fases\n", m->ruta);
+        return -1;
+    }
+    return 0;
+}
+
+/* Imprime el resumen estadístico de un motor */
+static void imprimir_resumen(const motor *m, const resumen_muestras *r)
+{
+    printf("%-13s n=%-3d mediana %.6f s | p95 %.6f s | media %.6f ± %.6f s (IC 95%%) | desv. %.6f s | mín %.6f | máx %.6f\n",
+           m->titulo, r->n, r->mediana, r->p95, r->media, r->ic95, r->desviacion, r->minimo, r->maximo);
+}
+
+static void uso(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [procesos|hilos|ambos|hibrido|todos] [-d PxT,...] [-w N] [-r N] [-f FASE] [-- opciones de los motores]\n"
+            "     %s [procesos|hilos|ambos|hibrido|todos] [-d PxT,...] -H HISTORIAL [-c CLAVE=VALOR]... [-f FASE]\n"
+            "  -d LISTA disposiciones del híbrido (hibrido_promedio): P procesos de T hilos, p. ej.\n"
+            "           1x8,2x4,4x2,8x1 (por defecto, todas las que ocupan los núcleos en línea).\n"
+            "           todos mide además procesos e hilos\n"
+            "  -w N     corridas de calentamiento que no se cuentan (por defecto 0)\n"
+            "  -r N     repeticiones medidas por motor (por defecto 1)\n"
+            "  -f FASE  métrica a comparar: total (cómputo + reducción, por defecto), lanzamiento,\n"
+            "           generacion, computo, reduccion o reporte\n"
+            "  -H RUTA  no lanza nada: toma las muestras de un historial JSON Lines (--historial)\n"
+            "  -c C=V   con -H, usa solo las corridas con ese campo (p. ej. trabajadores=4)\n"
+            "Con varios motores, las repeticiones se intercalan (procesos, hilos, procesos, ...).\n"
+            "Las corridas de calentamiento se lanzan con --historial %s para no registrarlas.\n"
+            "Ejemplo: %s ambos -w 2 -r 20 -- --semilla 7 --trabajadores 4\n"
+            "         %s ambos -H historial.jsonl -c trabajadores=4 -c semilla=7\n"
+            "         %s hibrido -d 1x8,2x4,4x2 -r 10 -- --semilla 7 --afinidad compacta\n",
+            prog, prog, HISTORIAL_NINGUNO, prog, prog, prog);
 }
 
 int main(int argc, char *argv[])
 {
     // argc: número de argumentos de línea de comandos
     // argv: arreglo de cadenas con los argumentos
-    if (argc < 2) {
-        fprintf(stderr, "Uso: %s [procesos|hilos|ambos]\n", argv[0]);
+    int calentamiento = 0, repeticiones = 1, fase = -1;
+    const char *historial = NULL, *disposiciones = NULL;
+    char *filtros[MAX_FILTROS];
+    int n_filtros = 0;
+    int c;
+    while ((c = getopt(argc, argv, "w:r:f:H:c:d:h")) != -1) {
+        switch (c) {
+        case 'd': disposiciones = optarg; break;
+        case 'H': historial = optarg; break;
+        case 'c':
+            if (n_filtros == MAX_FILTROS || !strchr(optarg, '=')) { uso(argv[0]); return EXIT_FAILURE; }
+            filtros[n_filtros++] = optarg;
+            break;
+        case 'w': calentamiento = atoi(optarg); break;
+        case 'r': repeticiones = atoi(optarg); break;
+        case 'f':
+            fase = -2;
+            if (strcmp(optarg, "total") == 0) fase = -1;
+            for (int k = 0; k < N_FASES; ++k)
+                if (strcmp(optarg, nombres_fase[k]) == 0) fase = k;
+            if (fase == -2) { fprintf(stderr, "❌  Fase no reconocida: %s\n", optarg); return EXIT_FAILURE; }
+            break;
+        case 'h': uso(argv[0]); return EXIT_SUCCESS;
+        default:  uso(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || calentamiento < 0 || repeticiones < 1) {
+        uso(argv[0]);
         return EXIT_FAILURE;
     }
+    const char *modo = argv[optind++];
+    if (optind < argc && strcmp(argv[optind], "--") == 0) optind++;
+    char **extra = argv + optind;
+    int n_extra = argc - optind;
 
     // Lógica de selección según argumento
-    if (strcmp(argv[1], "procesos") == 0)
-        lanzar("./procesos_promedio");
-    else if (strcmp(argv[1], "hilos") == 0)
-        lanzar("./hilos_promedio");
-    else if (strcmp(argv[1], "ambos") == 0) {
-        lanzar("./procesos_promedio");
-        lanzar("./hilos_promedio");
-        // Extrae y compara los tiempos de ambos resultados
-        double t_proc = extraer_tiempo("resultados_procesos.txt");
-        double t_hilo = extraer_tiempo("resultados_hilos.txt");
-        if (t_proc > 0 && t_hilo > 0) {
-            printf("\n=== Comparativa de tiempos ===\n");
-            printf("Procesos: %.6f s\n", t_proc);
-            printf("Hilos   : %.6f s\n", t_hilo);
-            if (t_proc < t_hilo)
-                printf("\nProcesos fue más rápido.\n");
-            else if (t_hilo < t_proc)
-                printf("\nHilos fue más rápido.\n");
-            else
-                printf("\nAmbos tuvieron el mismo tiempo.\n");
-        } else {
-            printf("\nNo se pudo extraer el tiempo de ambos resultados.\n");
+    static motor motores[MAX_MOTORES];
+    int n_motores = 0;
+    int clasicos = strcmp(modo, "todos") == 0 || strcmp(modo, "ambos") == 0;
+    if (clasicos || strcmp(modo, "procesos") == 0)
+        motores[n_motores++] = (motor){ .titulo = "Procesos", .nombre = "procesos", .ruta = "./procesos_promedio" };
+    if (clasicos || strcmp(modo, "hilos") == 0)
+        motores[n_motores++] = (motor){ .titulo = "Hilos", .nombre = "hilos", .ruta = "./hilos_promedio" };
+    if (strcmp(modo, "todos") == 0 || strcmp(modo, "hibrido") == 0) {
+        n_motores = agregar_disposiciones(motores, n_motores, disposiciones);
+        if (n_motores < 0) {
+            fprintf(stderr, "❌  Disposición no válida: %s (se espera PxT,PxT,...)\n", disposiciones);
+            return EXIT_FAILURE;
         }
-    } else {
-        fprintf(stderr, "\u274C  Opción no reconocida: %s\n", argv[1]);
+    } else if (disposiciones) {
+        fprintf(stderr, "❌  -d solo se usa con hibrido o todos\n");
+        return EXIT_FAILURE;
+    }
+    if (n_motores == 0) {
+        fprintf(stderr, "❌  Opción no reconocida: %s\n", modo);
         return EXIT_FAILURE;
     }
+
+    if (historial) {
+        // Las muestras salen del historial: no se lanza ningún motor
+        if (cargar_historial(historial, motores, n_motores, fase, filtros, n_filtros) < 0) return EXIT_FAILURE;
+        printf("\n=== Estadísticas (%s, historial %s) ===\n", fase < 0 ? "total" : nombres_fase[fase], historial);
+        calentamiento = repeticiones = 0;
+    }
+
+    // Una sola corrida sin calentamiento muestra la salida completa de los motores, como antes
+    int mostrar = (repeticiones == 1 && calentamiento == 0);
+    for (int i = 0; i < calentamiento + repeticiones; ++i) {
+        for (int e = 0; e < n_motores; ++e) {
+            motor *m = &motores[e];
+            double f[N_FASES];
+            if (mostrar) printf("\n===== Lanzando %s (%s) =====\n", m->ruta, m->titulo);
+            if (i < calentamiento) {
+                lanzar(m, extra, n_extra, 1, 0, f);   // El calentamiento no se cuenta
+                continue;
+            }
+            if (lanzar(m, extra, n_extra, 0, mostrar, f) != 0) continue;
+            agregar_muestra(m, f, fase);
+        }
+        if (!mostrar) {
+            printf("\r%s %d/%d", i < calentamiento ? "Calentamiento" : "Repetición   ",
+                   i < calentamiento ? i + 1 : i - calentamiento + 1,
+                   i < calentamiento ? calentamiento : repeticiones);
+            fflush(stdout);
+        }
+    }
+
+    // Resumen de cada motor: la métrica elegida y la mediana de cada fase
+    resumen_muestras resumenes[MAX_MOTORES];
+    if (!historial) {
+        if (!mostrar) printf("\n");
+        printf("\n=== Estadísticas (%s, %d repetición(es), %d de calentamiento) ===\n",
+               fase < 0 ? "total" : nombres_fase[fase], repeticiones, calentamiento);
+    }
+    for (int e = 0; e < n_motores; ++e) {
+        resumir(motores[e].muestras, motores[e].n, &resumenes[e]);
+        imprimir_resumen(&motores[e], &resumenes[e]);
+    }
+    printf("\n%-14s", "Fase (mediana)");
+    for (int e = 0; e < n_motores; ++e) printf(" | %13s", motores[e].titulo);
+    printf("\n");
+    for (int k = 0; k < N_FASES; ++k) {
+        printf("%-14s", nombres_fase[k]);
+        for (int e = 0; e < n_motores; ++e) {
+            resumen_muestras r;
+            resumir(motores[e].por_fase[k], motores[e].n, &r);
+            printf(" | %11.6f s", r.mediana);
+        }
+        printf("\n");
+    }
+
+    // Motores con muestras ordenados por tiempo medio (inserción: son pocos)
+    int orden[MAX_MOTORES], n_orden = 0;
+    for (int e = 0; e < n_motores; ++e) {
+        if (resumenes[e].n == 0) continue;
+        int k = n_orden++;
+        for (; k > 0 && resumenes[orden[k - 1]].media > resumenes[e].media; --k) orden[k] = orden[k - 1];
+        orden[k] = e;
+    }
+    if (n_motores > 1 && n_orden > 1) {
+        // Solo se declara un ganador si la diferencia con el segundo es significativa (Welch, 95%)
+        printf("\n=== Comparativa de tiempos ===\n");
+        if (n_orden > 2)
+            for (int k = 0; k < n_orden; ++k)
+                printf("%2d. %-13s media %.6f s | mediana %.6f s\n", k + 1, motores[orden[k]].titulo,
+                       resumenes[orden[k]].media, resumenes[orden[k]].mediana);
+        const resumen_muestras *mejor = &resumenes[orden[0]], *segundo = &resumenes[orden[1]];
+        double t, gl;
+        int significativa = welch(mejor, segundo, &t, &gl);
+        if (significativa < 0) {
+            printf("Se necesitan al menos 2 repeticiones por motor para comparar (use -r).\n");
+        } else if (!significativa) {
+            printf("Sin diferencia significativa al 95%% entre %s y %s (t de Welch = %.3f, gl = %.1f).\n",
+                   motores[orden[0]].titulo, motores[orden[1]].titulo, t, gl);
+        } else {
+            double ventaja = 100.0 * (segundo->media - mejor->media) / segundo->media;
+            printf("%s fue más rápido que %s: %.1f%% menos tiempo medio (t de Welch = %.3f, gl = %.1f, 95%%).\n",
+                   motores[orden[0]].titulo, motores[orden[1]].titulo, ventaja, t, gl);
+        }
+    }
+
+    for (int e = 0; e < n_motores; ++e) {
+        free(motores[e].muestras);
+        for (int k = 0; k < N_FASES; ++k) free(motores[e].por_fase[k]);
+    }
     return EXIT_SUCCESS;
 }
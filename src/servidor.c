@@ -0,0 +1,151 @@
+#include "servidor.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "estadistica.h"
+
+/* Latencias de las consultas atendidas (segundos) */
+typedef struct {
+    double *valores;
+    int n;
+    int capacidad;
+    struct timespec primera;   // Llegada de la primera consulta
+    struct timespec ultima;    // Respuesta de la última
+} latencias;
+
+static void registrar_latencia(latencias *l, double segundos)
+{
+    if (l->n == l->capacidad) {
+        l->capacidad = l->capacidad ? 2 * l->capacidad : 1024;
+        l->valores = realloc(l->valores, sizeof(double) * l->capacidad);
+        if (!l->valores) { perror("realloc"); exit(EXIT_FAILURE); }
+    }
+    l->valores[l->n++] = segundos;
+}
+
+/*
+ * Atiende las consultas de una entrada hasta que se termina o llega "salir".
+ * Retorna 1 si se pidió salir o -1 si una consulta falló.
+ */
+static int atender_entrada(FILE *entrada, FILE *salida, long total, atender_consulta atender,
+                           void *contexto, latencias *l)
+{
+    char linea[256];
+    while (fgets(linea, sizeof(linea), entrada)) {
+        char orden[16];
+        consulta q = { 0, total };
+        if (sscanf(linea, "%15s", orden) != 1 || orden[0] == '#') continue;   // Vacías y comentarios
+        if (strcmp(orden, "salir") == 0) return 1;
+        if (strcmp(orden, "rango") == 0) {
+            if (sscanf(linea, "%*s %ld %ld", &q.inicio, &q.cantidad) != 2) {
+                fprintf(salida, "error uso: rango INICIO CANTIDAD\n");
+                fflush(salida);
+                continue;
+            }
+        } else if (strcmp(orden, "todo") != 0) {
+            fprintf(salida, "error consulta desconocida: %s\n", orden);
+            fflush(salida);
+            continue;
+        }
+        if (q.inicio < 0 || q.cantidad < 1 || q.inicio > total - q.cantidad) {
+            fprintf(salida, "error rango fuera de [0, %ld)\n", total);
+            fflush(salida);
+            continue;
+        }
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        conteo c = {0};
+        if (atender(contexto, &q, &c) != 0) {
+            fprintf(salida, "error los trabajadores fallaron\n");
+            fflush(salida);
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (c.fuera) {
+            // Un archivo ajeno: la consulta no vale, pero el servidor sigue atendiendo
+            fprintf(salida, "error %lld nota(s) fuera de [0, %d] en el rango\n", c.fuera, MAX_NOTA);
+            fflush(salida);
+            continue;
+        }
+        if (l->n == 0) l->primera = t0;
+        l->ultima = t1;
+        registrar_latencia(l, segundos_entre(t0, t1));
+
+        fprintf(salida, "ok notas=%ld promedio=%.4f reprobados=%lld aprobado_bajo=%lld aprobado_alto=%lld latencia_us=%.1f\n",
+                q.cantidad, (double)c.suma / q.cantidad, c.reprobados, c.aprobado_bajo, c.aprobado_alto,
+                1e6 * segundos_entre(t0, t1));
+        fflush(salida);
+    }
+    return 0;
+}
+
+/* Crea el socket Unix en ruta (reemplazando uno viejo) y lo deja escuchando; -1 si falla */
+static int abrir_socket(const char *ruta)
+{
+    struct sockaddr_un dir = { .sun_family = AF_UNIX };
+    if (strlen(ruta) >= sizeof(dir.sun_path)) { fprintf(stderr, "%s: ruta de socket muy larga\n", ruta); return -1; }
+    strcpy(dir.sun_path, ruta);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+    unlink(ruta);
+    if (bind(fd, (struct sockaddr *)&dir, sizeof(dir)) != 0 || listen(fd, 16) != 0) {
+        perror(ruta);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int servir(const char *socket, long total, atender_consulta atender, void *contexto, const char *titulo)
+{
+    latencias l = {0};
+    int salir = 0;   // 1: se pidió salir; -1: una consulta falló
+    if (socket) {
+        int escucha = abrir_socket(socket);
+        if (escucha < 0) return -1;
+        signal(SIGPIPE, SIG_IGN);   // Un cliente que se va no debe tumbar al servidor
+        fprintf(stderr, "Atendiendo consultas en %s\n", socket);
+        while (!salir) {
+            int cliente = accept(escucha, NULL, NULL);
+            if (cliente < 0) { perror("accept"); break; }
+            // Cada FILE es dueño de su descriptor: si fdopen falla, el descriptor se cierra a mano
+            int copia = dup(cliente);
+            FILE *entrada = fdopen(cliente, "r");
+            FILE *salida = copia >= 0 ? fdopen(copia, "w") : NULL;
+            if (entrada && salida) salir = atender_entrada(entrada, salida, total, atender, contexto, &l);
+            else perror("fdopen");
+            if (entrada) fclose(entrada); else close(cliente);
+            if (salida) fclose(salida); else if (copia >= 0) close(copia);
+        }
+        close(escucha);
+        unlink(socket);
+    } else {
+        salir = atender_entrada(stdin, stdout, total, atender, contexto, &l);
+    }
+
+    // Resumen: consultas por segundo y latencia de cada consulta
+    printf("\n=== Servidor (%s) ===\n", titulo);
+    printf("Consultas: %d\n", l.n);
+    if (l.n > 0) {
+        double servicio = 0;
+        for (int i = 0; i < l.n; ++i) servicio += l.valores[i];
+        double reloj = segundos_entre(l.primera, l.ultima);
+        resumen_muestras r;
+        resumir(l.valores, l.n, &r);   // Deja las latencias ordenadas
+        printf("Consultas por segundo: %.1f (tiempo de servicio) | %.1f (reloj, incluye esperar la entrada)\n",
+               l.n / servicio, reloj > 0 ? l.n / reloj : 0.0);
+        printf("Latencia: p50 %.1f us | p99 %.1f us | media %.1f us | mín %.1f us | máx %.1f us\n",
+               1e6 * r.mediana, 1e6 * percentil(l.valores, l.n, 0.99), 1e6 * r.media,
+               1e6 * r.minimo, 1e6 * r.maximo);
+    }
+    free(l.valores);
+    return salir < 0 ? -1 : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include "clasificacion.h"
+
+/* Consulta de agregación sobre las notas residentes: el rango [inicio, inicio + cantidad) */
+typedef struct {
+    long inicio;
+    long cantidad;
+} consulta;
+
+/*
+ * Resuelve una consulta con el grupo de trabajadores ya creado y deja en c la
+ * suma, las tres categorías y las notas fuera de rango del rango (si hay, la
+ * consulta se responde con un error). Retorna 0, o -1 si los
+ * trabajadores fallaron y el servidor ya no puede atender más consultas.
+ */
+typedef int (*atender_consulta)(void *contexto, const consulta *q, conteo *c);
+
+/*
+ * Lee consultas, una por línea, y responde cada una en una línea:
+ *   todo                    todas las notas
+ *   rango INICIO CANTIDAD   las notas [INICIO, INICIO + CANTIDAD)
+ *   salir                   termina (también al terminar la entrada)
+ * Respuesta: "ok notas=N promedio=P reprobados=R aprobado_bajo=B aprobado_alto=A latencia_us=L"
+ * o "error <motivo>".
+ * socket: ruta de un socket Unix en el que se atienden clientes uno tras otro
+ * hasta recibir "salir"; NULL para leer de stdin y responder en stdout.
+ * total: notas residentes. titulo: nombre del motor para el resumen final, que
+ * reporta la cantidad de consultas, las consultas por segundo y la latencia p50/p99.
+ * Retorna 0, o -1 si no se pudo abrir el socket o una consulta falló.
+ */
+int servir(const char *socket, long total, atender_consulta atender, void *contexto, const char *titulo);
+
+#endif
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "tuberia.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "archivo.h"
+#include "generador.h"
+
+/* Prepara un anillo vacío de capacidad (potencia de dos) celdas; 0 o -1 */
+static int anillo_iniciar(anillo *a, size_t capacidad)
+{
+    a->celdas = aligned_alloc(LINEA_CACHE, sizeof(celda_anillo) * capacidad);
+    if (!a->celdas) return -1;
+    a->mascara = capacidad - 1;
+    for (size_t i = 0; i < capacidad; ++i) atomic_init(&a->celdas[i].secuencia, i);
+    atomic_init(&a->cola, 0);
+    atomic_init(&a->cabeza, 0);
+    return 0;
+}
+
+/* Pone v al final; retorna 0 si el anillo está lleno */
+static int anillo_poner(anillo *a, long v)
+{
+    size_t pos = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    for (;;) {
+        celda_anillo *c = &a->celdas[pos & a->mascara];
+        size_t sec = atomic_load_explicit(&c->secuencia, memory_order_acquire);
+        intptr_t dif = (intptr_t)sec - (intptr_t)pos;
+        if (dif == 0) {
+            // La celda está libre en esta vuelta: se reserva avanzando la cola
+            if (atomic_compare_exchange_weak_explicit(&a->cola, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                c->valor = v;
+                atomic_store_explicit(&c->secuencia, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;   // Todavía no la vació el consumidor de la vuelta anterior
+        } else {
+            pos = atomic_load_explicit(&a->cola, memory_order_relaxed);
+        }
+    }
+}
+
+/* Saca el primer valor en *v; retorna 0 si el anillo está vacío */
+static int anillo_sacar(anillo *a, long *v)
+{
+    size_t pos = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    for (;;) {
+        celda_anillo *c = &a->celdas[pos & a->mascara];
+        size_t sec = atomic_load_explicit(&c->secuencia, memory_order_acquire);
+        intptr_t dif = (intptr_t)sec - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&a->cabeza, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *v = c->valor;
+                // Queda libre para la siguiente vuelta de escritura
+                atomic_store_explicit(&c->secuencia, pos + a->mascara + 1, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;   // El productor aún no la llenó
+        } else {
+            pos = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+        }
+    }
+}
+
+/* Valores en el anillo en este momento (aproximado si hay operaciones en curso) */
+static long anillo_ocupacion(const anillo *a)
+{
+    size_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    size_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    return cola > cabeza ? (long)(cola - cabeza) : 0;
+}
+
+int tuberia_iniciar(tuberia *t, int productores, int consumidores, long tam_trozo,
+                    long desde, long total, int fd, uint64_t semilla)
+{
+    memset(t, 0, sizeof(*t));
+    // Dos búferes por participante, redondeado a potencia de dos para los anillos
+    int n = 2;
+    while (n < 2 * (productores + consumidores)) n *= 2;
+    t->n_trozos = n;
+    t->tam_trozo = tam_trozo;
+    t->desde = desde;
+    t->total = total;
+    t->n_bloques = (total - desde + tam_trozo - 1) / tam_trozo;
+    t->fd = fd;
+    t->semilla = semilla;
+    t->n_productores = productores;
+    t->n_consumidores = consumidores;
+    atomic_init(&t->siguiente, 0);
+    atomic_init(&t->productores_activos, productores);
+
+    size_t bytes_trozo = ((size_t)tam_trozo * sizeof(nota_t) + LINEA_CACHE - 1) & ~(size_t)(LINEA_CACHE - 1);
+    t->buferes = aligned_alloc(LINEA_CACHE, bytes_trozo * (size_t)n);
+    t->trozos = malloc(sizeof(trozo) * (size_t)n);
+    t->productores = aligned_alloc(LINEA_CACHE, sizeof(etapa_trabajador) * (size_t)productores);
+    t->consumidores = aligned_alloc(LINEA_CACHE, sizeof(etapa_trabajador) * (size_t)consumidores);
+    if (!t->buferes || !t->trozos || !t->productores || !t->consumidores
+        || anillo_iniciar(&t->libres, (size_t)n) != 0 || anillo_iniciar(&t->llenos, (size_t)n) != 0) {
+        tuberia_liberar(t);
+        return -1;
+    }
+    memset(t->productores, 0, sizeof(etapa_trabajador) * (size_t)productores);
+    memset(t->consumidores, 0, sizeof(etapa_trabajador) * (size_t)consumidores);
+    for (int i = 0; i < n; ++i) {
+        t->trozos[i].notas = (nota_t *)((char *)t->buferes + bytes_trozo * (size_t)i);
+        anillo_poner(&t->libres, i);
+    }
+    return 0;
+}
+
+/* Lee las notas del trozo z del archivo y pide por adelantado el que sigue a este productor */
+static void leer_trozo(const tuberia *t, trozo *z)
+{
+    off_t lugar = (off_t)sizeof(cabecera_notas) + (off_t)z->inicio * (off_t)sizeof(nota_t);
+    size_t bytes = (size_t)z->cantidad * sizeof(nota_t), leidos = 0;
+    off_t proximo = lugar + (off_t)t->tam_trozo * t->n_productores * (off_t)sizeof(nota_t);
+    posix_fadvise(t->fd, proximo, (off_t)t->tam_trozo * (off_t)sizeof(nota_t), POSIX_FADV_WILLNEED);
+    while (leidos < bytes) {
+        ssize_t n = pread(t->fd, (char *)z->notas + leidos, bytes - leidos, lugar + (off_t)leidos);
+        if (n <= 0) { perror("pread"); exit(EXIT_FAILURE); }
+        leidos += (size_t)n;
+    }
+}
+
+void tuberia_producir(tuberia *t, int id)
+{
+    etapa_trabajador *e = &t->productores[id];
+    for (;;) {
+        long b = atomic_fetch_add_explicit(&t->siguiente, 1, memory_order_relaxed);
+        if (b >= t->n_bloques) break;
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        long z;
+        while (!anillo_sacar(&t->libres, &z)) sched_yield(); // Todos los búferes en uso: consumo lento
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        trozo *tz = &t->trozos[z];
+        tz->inicio = t->desde + b * t->tam_trozo;
+        tz->cantidad = t->total - tz->inicio < t->tam_trozo ? t->total - tz->inicio : t->tam_trozo;
+        if (t->fd >= 0) leer_trozo(t, tz);
+        else generar_notas_en(tz->notas, tz->inicio, tz->cantidad, t->semilla);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        // Hay tantas celdas como búferes: la cola de llenos nunca está llena
+        anillo_poner(&t->llenos, z);
+        e->espera  += segundos_entre(t0, t1);
+        e->ocupado += segundos_entre(t1, t2);
+        e->trozos++;
+        e->notas += tz->cantidad;
+    }
+    atomic_fetch_sub_explicit(&t->productores_activos, 1, memory_order_release);
+}
+
+const trozo *tuberia_tomar(tuberia *t, int id)
+{
+    etapa_trabajador *e = &t->consumidores[id];
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long z = -1;
+    for (;;) {
+        long ocupacion = anillo_ocupacion(&t->llenos);
+        if (anillo_sacar(&t->llenos, &z)) {
+            e->ocupacion += ocupacion;
+            if (ocupacion > e->ocupacion_max) e->ocupacion_max = ocupacion;
+            break;
+        }
+        if (atomic_load_explicit(&t->productores_activos, memory_order_acquire) == 0) {
+            // Los productores terminaron: lo que quede ya está en la cola
+            if (!anillo_sacar(&t->llenos, &z)) z = -1;
+            break;
+        }
+        sched_yield();  // Cola vacía: producción lenta
+    }
+    clock_gettime(CLOCK_MONOTONIC, &e->marca);
+    e->espera += segundos_entre(t0, e->marca);
+    if (z < 0) return NULL;
+    e->trozos++;
+    e->notas += t->trozos[z].cantidad;
+    return &t->trozos[z];
+}
+
+void tuberia_devolver(tuberia *t, int id, const trozo *z)
+{
+    etapa_trabajador *e = &t->consumidores[id];
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    e->ocupado += segundos_entre(e->marca, ahora);
+    anillo_poner(&t->libres, z - t->trozos);
+}
+
+/* Suma las cuentas de n participantes de una etapa */
+static etapa_trabajador sumar_etapa(const etapa_trabajador *v, int n)
+{
+    etapa_trabajador s = {0};
+    for (int i = 0; i < n; ++i) {
+        s.trozos += v[i].trozos;
+        s.notas += v[i].notas;
+        s.ocupado += v[i].ocupado;
+        s.espera += v[i].espera;
+        s.ocupacion += v[i].ocupacion;
+        if (v[i].ocupacion_max > s.ocupacion_max) s.ocupacion_max = v[i].ocupacion_max;
+    }
+    return s;
+}
+
+/* Imprime una etapa: su capacidad (lo que rendiría sin esperar) y cómo repartió su tiempo */
+static double imprimir_etapa(const char *nombre, const etapa_trabajador *s, int n, const char *espera)
+{
+    // Capacidad: todas las notas de la etapa en el tiempo ocupado promedio de sus hilos
+    double capacidad = gbps(s->notas, s->ocupado / n);
+    double tiempo = s->ocupado + s->espera;
+    printf("%s: capacidad %.2f GB/s con %d hilo(s) | Ocupados: %.1f%% | Esperando %s: %.1f%%\n",
+           nombre, capacidad, n, tiempo > 0 ? 100 * s->ocupado / tiempo : 0, espera,
+           tiempo > 0 ? 100 * s->espera / tiempo : 0);
+    return capacidad;
+}
+
+void tuberia_imprimir(const tuberia *t)
+{
+    etapa_trabajador p = sumar_etapa(t->productores, t->n_productores);
+    etapa_trabajador c = sumar_etapa(t->consumidores, t->n_consumidores);
+    printf("\n=== Tubería (%d productores, %d consumidores, %d trozos de %ld KiB) ===\n",
+           t->n_productores, t->n_consumidores, t->n_trozos, t->tam_trozo * (long)sizeof(nota_t) / 1024);
+    double produccion = imprimir_etapa(t->fd >= 0 ? "Lectura (pread)" : "Generación", &p, t->n_productores,
+                                       "búfer libre");
+    double consumo = imprimir_etapa("Agregación", &c, t->n_consumidores, "trozo lleno");
+    printf("Cola de trozos llenos: ocupación media %.2f de %d, máxima %ld\n",
+           c.trozos ? (double)c.ocupacion / c.trozos : 0, t->n_trozos, c.ocupacion_max);
+    printf("Cuello de botella: %s\n", produccion < consumo ? (t->fd >= 0 ? "lectura" : "generación") : "agregación");
+}
+
+void tuberia_liberar(tuberia *t)
+{
+    free(t->buferes);
+    free(t->trozos);
+    free(t->productores);
+    free(t->consumidores);
+    free(t->libres.celdas);
+    free(t->llenos.celdas);
+    memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,101 @@
+#ifndef TUBERIA_H
+#define TUBERIA_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agregacion.h"   // LINEA_CACHE
+#include "comun.h"
+
+/*
+ * Cola circular acotada de varios productores y varios consumidores sin
+ * bloqueos (la de Vyukov): cada celda lleva un número de secuencia que dice
+ * si está libre para la vuelta actual de escritura o lista para leerse, así
+ * que poner y sacar cuestan una comparación-intercambio sobre su índice.
+ */
+typedef struct {
+    _Alignas(LINEA_CACHE) _Atomic size_t secuencia;
+    long valor;
+} celda_anillo;
+
+typedef struct {
+    celda_anillo *celdas;
+    size_t mascara;           // Capacidad - 1 (la capacidad es potencia de dos)
+    _Alignas(LINEA_CACHE) _Atomic size_t cola;   // Próxima posición a escribir
+    _Alignas(LINEA_CACHE) _Atomic size_t cabeza; // Próxima posición a leer
+} anillo;
+
+/* Trozo de notas consecutivas [inicio, inicio + cantidad) en su búfer */
+typedef struct {
+    long inicio;
+    long cantidad;
+    nota_t *notas;
+} trozo;
+
+/* Cuentas de un productor o un consumidor, cada uno en su línea de caché */
+typedef struct {
+    _Alignas(LINEA_CACHE) long trozos;
+    long notas;
+    double ocupado;           // Segundos generando o leyendo (productor) o procesando (consumidor)
+    double espera;            // Segundos esperando un trozo libre (productor) o lleno (consumidor)
+    long long ocupacion;      // Suma de los trozos llenos en cola en cada toma (consumidor)
+    long ocupacion_max;
+    struct timespec marca;    // Momento en que el consumidor tomó su trozo actual
+} etapa_trabajador;
+
+/*
+ * Tubería de ingreso y agregación: los productores generan o leen trozos de
+ * notas en búferes libres y los ponen en la cola de llenos; los consumidores
+ * los procesan y devuelven el búfer a la cola de libres. Con dos búferes por
+ * participante, cada uno siempre tiene otro a mano mientras usa el suyo.
+ */
+typedef struct {
+    anillo libres;            // Búferes vacíos para los productores
+    anillo llenos;            // Trozos listos para los consumidores
+    trozo *trozos;
+    nota_t *buferes;
+    int n_trozos;
+    long tam_trozo;           // Notas por trozo
+    long desde, total;        // Se recorren las notas [desde, total)
+    long n_bloques;           // Trozos a producir en total
+    int fd;                   // Archivo de notas a leer con pread (-1: se generan)
+    uint64_t semilla;
+    int n_productores, n_consumidores;
+    etapa_trabajador *productores, *consumidores;
+    _Alignas(LINEA_CACHE) _Atomic long siguiente; // Próximo trozo a producir
+    _Atomic int productores_activos;
+} tuberia;
+
+/*
+ * Prepara la tubería para recorrer las notas [desde, total) en trozos de
+ * tam_trozo notas, generadas con semilla o, si fd >= 0, leídas de ese archivo
+ * de notas. Retorna 0 o -1 si falta memoria.
+ */
+int tuberia_iniciar(tuberia *t, int productores, int consumidores, long tam_trozo,
+                    long desde, long total, int fd, uint64_t semilla);
+
+/*
+ * Bucle del productor id: toma el siguiente trozo por producir, espera un
+ * búfer libre, lo llena y lo pone en la cola de llenos hasta que no quedan.
+ */
+void tuberia_producir(tuberia *t, int id);
+
+/*
+ * Entrega al consumidor id el siguiente trozo lleno (esperando si la cola está
+ * vacía) o NULL cuando los productores terminaron y ya no queda ninguno.
+ */
+const trozo *tuberia_tomar(tuberia *t, int id);
+
+/* El consumidor id terminó con z: su búfer vuelve a la cola de libres */
+void tuberia_devolver(tuberia *t, int id, const trozo *z);
+
+/*
+ * Imprime la capacidad de cada etapa, cuánto esperó cada una, la ocupación de
+ * la cola de llenos y cuál etapa es el cuello de botella.
+ */
+void tuberia_imprimir(const tuberia *t);
+
+void tuberia_liberar(tuberia *t);
+
+#endif